@@ -18,7 +18,17 @@
 #include "picsoumodelservice.h"
 #include "utils/macro.h"
 
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QFutureWatcher>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QXmlStreamReader>
@@ -39,6 +49,109 @@ static const QString XML_ATTR_BUDGET="budget";
 static const QString XML_ATTR_RECIPIENT="recipient";
 static const QString XML_ATTR_PAYMENT_METHOD="paymentMethod";
 static const QString XML_ATTR_DESCRIPTION="description";
+static const QString JOURNAL_SUFFIX=".jnl";
+static const QString BACKUP_SUFFIX=".bak";
+static const int BACKUP_COUNT=3;
+
+static QString journal_filename(const QString &filename)
+{
+    return filename+JOURNAL_SUFFIX;
+}
+
+static QString backup_filename(const QString &filename, int index)
+{
+    return QString("%0.%1%2").arg(filename).arg(index).arg(BACKUP_SUFFIX);
+}
+
+static bool sync_file(QFile &f)
+{
+    if(!f.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(f.handle())==0;
+#else
+    return fsync(f.handle())==0;
+#endif
+}
+
+static bool rotate_backups(const QString &filename)
+{
+    LOG_IN("filename="<<filename)
+    if(BACKUP_COUNT<=0||!QFile::exists(filename)) {
+        LOG_BOOL_RETURN(true)
+    }
+    /* oldest backup is dropped, others are shifted by one */
+    QFile::remove(backup_filename(filename, BACKUP_COUNT));
+    for(int i=BACKUP_COUNT-1; i>0; --i) {
+        if(QFile::exists(backup_filename(filename, i))&&
+           !QFile::rename(backup_filename(filename, i), backup_filename(filename, i+1))) {
+            LOG_BOOL_RETURN(false)
+        }
+    }
+    /* live file is copied, never moved, so that it stays in place until
+       the new one atomically replaces it */
+    QFile::remove(backup_filename(filename, 1));
+    LOG_BOOL_RETURN(QFile::copy(filename, backup_filename(filename, 1)))
+}
+
+static bool write_db_file(const PicsouDB::Snapshot &snapshot, const QString &filename)
+{
+    LOG_IN("<Snapshot>,filename="<<filename)
+    /* users and modified segments are encrypted here rather than on the UI thread */
+    QJsonObject json;
+    if(!snapshot.wrap(json)) {
+        LOG_BOOL_RETURN(false)
+    }
+    QByteArray compressed=qCompress(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    /* data goes to a temporary file which is synced to disk and renamed over
+       the previous one on commit, the file is never truncated in place */
+    QSaveFile f(filename);
+    f.setDirectWriteFallback(false);
+    if(!f.open(QIODevice::WriteOnly)) {
+        LOG_BOOL_RETURN(false)
+    }
+    if(f.write(compressed)!=compressed.size()) {
+        f.cancelWriting();
+        LOG_BOOL_RETURN(false)
+    }
+    /* previous version must be kept before it gets replaced */
+    if(!rotate_backups(filename)) {
+        LOG_CRITICAL("failed to backup database file, save aborted.")
+        f.cancelWriting();
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_BOOL_RETURN(f.commit())
+}
+
+typedef QPair<UserShPtr, QString> UserDecryptTask;
+
+struct SegmentDecryptTask
+{
+    UserShPtr user; /* keeps the key owner alive while decrypting */
+    AccountShPtr account;
+    QString wseg;
+};
+
+struct UserDecryptor
+{
+    typedef PicsouDBO::Decrypted result_type;
+
+    PicsouDBO::Decrypted operator()(const UserDecryptTask &task)
+    {
+        return task.first->decrypt(task.second);
+    }
+};
+
+struct SegmentDecryptor
+{
+    typedef ColumnarDocument result_type;
+
+    ColumnarDocument operator()(const SegmentDecryptTask &task)
+    {
+        return task.account->decrypt_segment(task.wseg);
+    }
+};
 
 PicsouModelService::~PicsouModelService()
 {
@@ -51,9 +164,16 @@ PicsouModelService::PicsouModelService(PicsouApplication *papp) :
     PicsouAbstractService(papp),
     m_db(nullptr),
     m_filename(QString()),
-    m_is_db_modified(false)
+    m_is_db_modified(false),
+    m_journal_valid(false),
+    m_modification_count(0),
+    m_saving_count(0),
+    m_saving_filename(QString()),
+    m_save_pending(false),
+    m_pending_filename(QString())
 {
     LOG_IN("papp="<<papp)
+    connect(&m_save_watcher, &QFutureWatcher<bool>::finished, this, &PicsouModelService::save_finished);
     LOG_VOID_RETURN()
 }
 
@@ -85,7 +205,8 @@ bool PicsouModelService::new_db(QString filename,
                                  description));
     m_filename=filename;
     m_is_db_modified=true;
-    connect(m_db.data(), &PicsouDB::modified, this, &PicsouModelService::dbo_modified);
+    m_journal_valid=false;
+    connect(m_db.data(), &PicsouDB::changed, this, &PicsouModelService::dbo_modified);
     connect(m_db.data(), &PicsouDB::unwrapped, this, &PicsouModelService::dbo_unwrapped);
     LOG_BOOL_RETURN(true)
 }
@@ -96,21 +217,8 @@ bool PicsouModelService::open_db(QString filename)
     if(is_db_opened()) {
         LOG_BOOL_RETURN(false)
     }
-    QFile f(filename);
-    if(!f.open(QIODevice::ReadOnly)) {
-        LOG_BOOL_RETURN(false)
-    }
-    QByteArray raw=f.readAll();
-    /* attempt uncompressing */
-    QByteArray jdata=qUncompress(raw);
-    if(jdata.isEmpty()) {
-        /* ensure backward compatibility */
-        jdata=raw;
-    }
-    /* parse json data */
-    QJsonParseError err;
-    QJsonDocument doc=QJsonDocument::fromJson(jdata, &err);
-    if(doc.isNull()) {
+    QJsonDocument doc;
+    if(!read_newest_db_file(filename, doc)) {
         LOG_CRITICAL("JSON document is NULL!")
         LOG_BOOL_RETURN(false)
     }
@@ -137,51 +245,289 @@ bool PicsouModelService::open_db(QString filename)
         LOG_CRITICAL("conversion failed or database is corrupted.")
         LOG_BOOL_RETURN(false)
     }
-    /* success */
+    /* success, replay changes saved after last compaction */
     m_filename=filename;
-    connect(m_db.data(), &PicsouDB::modified, this, &PicsouModelService::dbo_modified);
+    m_journal_valid=read_journal(filename);
+    connect(m_db.data(), &PicsouDB::changed, this, &PicsouModelService::dbo_modified);
     connect(m_db.data(), &PicsouDB::unwrapped, this, &PicsouModelService::dbo_unwrapped);
     LOG_BOOL_RETURN(true)
 }
 
-bool PicsouModelService::save_db()
+bool PicsouModelService::read_newest_db_file(const QString &filename, QJsonDocument &doc)
 {
-    LOG_IN_VOID()
-    LOG_BOOL_RETURN(save_db_as(m_filename))
+    LOG_IN("filename="<<filename)
+    if(read_db_file(filename, doc)) {
+        LOG_BOOL_RETURN(true)
+    }
+    /* last save did not complete, pick the newest generation among valid backups */
+    LOG_WARNING("database file is missing or corrupted, looking for a valid backup.")
+    int generation=-1;
+    QJsonDocument candidate;
+    for(int i=1; i<=BACKUP_COUNT; ++i) {
+        if(!read_db_file(backup_filename(filename, i), candidate)) {
+            continue;
+        }
+        int candidate_generation=candidate.object()[PicsouDB::KW_GENERATION].toInt(0);
+        if(candidate_generation>generation) {
+            LOG_DEBUG("-> backup "<<i<<" has generation "<<candidate_generation)
+            generation=candidate_generation;
+            doc=candidate;
+        }
+    }
+    if(generation<0) {
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_WARNING("database recovered from backup of generation "<<generation<<".")
+    LOG_BOOL_RETURN(true)
 }
 
-bool PicsouModelService::save_db_as(QString filename)
+bool PicsouModelService::read_db_file(const QString &filename, QJsonDocument &doc)
 {
     LOG_IN("filename="<<filename)
-    if(!is_db_opened()) {
+    QFile f(filename);
+    if(!f.open(QIODevice::ReadOnly)) {
         LOG_BOOL_RETURN(false)
     }
-    QJsonObject json;
-    if(!m_db->write(json)) {
+    bool success=read_db_file(f, doc);
+    f.close();
+    LOG_BOOL_RETURN(success)
+}
+
+bool PicsouModelService::read_db_file(QFile &f, QJsonDocument &doc)
+{
+    LOG_IN("&f="<<&f)
+    /* map the file rather than reading it so that compressed bytes are
+       backed by the page cache instead of a private heap copy */
+    QByteArray copy;
+    qint64 size=f.size();
+    const uchar *raw=f.map(0, size);
+    bool mapped=(raw!=nullptr);
+    if(!mapped) {
+        LOG_WARNING("failed to map database file, falling back to a full read.")
+        copy=f.readAll();
+        raw=reinterpret_cast<const uchar*>(copy.constData());
+        size=copy.size();
+    }
+    QJsonParseError err;
+    {
+        /* attempt uncompressing, inflated buffer is released as soon as the DOM is built */
+        QByteArray jdata=qUncompress(raw, static_cast<int>(size));
+        if(jdata.isEmpty()) {
+            /* ensure backward compatibility without duplicating raw bytes */
+            jdata=QByteArray::fromRawData(reinterpret_cast<const char*>(raw),
+                                          static_cast<int>(size));
+        }
+        doc=QJsonDocument::fromJson(jdata, &err);
+    }
+    if(mapped) {
+        f.unmap(const_cast<uchar*>(raw));
+    }
+    if(doc.isNull()) {
+        LOG_CRITICAL("failed to parse JSON: "<<err.errorString())
         LOG_BOOL_RETURN(false)
     }
-    QFile f(filename);
-    if(!f.open(QIODevice::WriteOnly)) {
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouModelService::read_journal(const QString &filename)
+{
+    LOG_IN("filename="<<filename)
+    QFile f(journal_filename(filename));
+    if(!f.exists()) {
         LOG_BOOL_RETURN(false)
     }
-    QByteArray jdata=QJsonDocument(json).toJson(QJsonDocument::Compact);
-    QByteArray compressed=qCompress(jdata);
-    if(f.write(compressed)!=compressed.size()) {
+    if(!f.open(QIODevice::ReadOnly)) {
+        LOG_WARNING("failed to open journal file.")
+        LOG_BOOL_RETURN(false)
+    }
+    QJsonObject header=QJsonDocument::fromJson(f.readLine()).object();
+    if(header[PicsouDB::KW_GENERATION].toInt(-1)!=m_db->generation()) {
+        /* journal predates last compaction */
+        LOG_WARNING("journal generation does not match database generation, ignoring it.")
+        LOG_BOOL_RETURN(false)
+    }
+    int count=0;
+    while(!f.atEnd()) {
+        QJsonDocument doc=QJsonDocument::fromJson(f.readLine());
+        if(!doc.isObject()) {
+            /* last append was interrupted, next save will compact */
+            LOG_WARNING("truncated journal record, ignoring remaining records.")
+            LOG_BOOL_RETURN(false)
+        }
+        m_db->read_journal(doc.object());
+        count++;
+    }
+    LOG_DEBUG("-> count="<<count)
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouModelService::reset_journal(const QString &filename)
+{
+    LOG_IN("filename="<<filename)
+    QFile f(journal_filename(filename));
+    if(!f.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        LOG_BOOL_RETURN(false)
+    }
+    QJsonObject header;
+    header[PicsouDB::KW_GENERATION]=m_db->generation();
+    QByteArray line=QJsonDocument(header).toJson(QJsonDocument::Compact)+'\n';
+    if(f.write(line)!=line.size()||!sync_file(f)) {
         LOG_BOOL_RETURN(false)
     }
     f.close();
-    m_filename=filename;
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouModelService::append_journal()
+{
+    LOG_IN_VOID()
+    QList<QByteArray> records;
+    if(!m_db->write_journal(records)) {
+        LOG_BOOL_RETURN(false)
+    }
+    QFile f(journal_filename(m_filename));
+    if(!f.open(QIODevice::WriteOnly|QIODevice::Append)) {
+        LOG_BOOL_RETURN(false)
+    }
+    for(auto &record : records) {
+        record.append('\n');
+        if(f.write(record)!=record.size()) {
+            /* a partial record would corrupt next ones, compact on next save */
+            m_journal_valid=false;
+            LOG_BOOL_RETURN(false)
+        }
+    }
+    /* changes are only marked as saved once they reached the disk */
+    if(!sync_file(f)) {
+        m_journal_valid=false;
+        LOG_BOOL_RETURN(false)
+    }
+    f.close();
+    m_db->mark_saved();
     m_is_db_modified=false;
+    LOG_DEBUG("-> records.length="<<records.length())
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouModelService::save_db()
+{
+    LOG_IN_VOID()
+    if(!is_db_opened()) {
+        LOG_BOOL_RETURN(false)
+    }
+    if(is_db_saving()) {
+        /* changes made meanwhile are saved once current save completes */
+        m_save_pending=true;
+        LOG_BOOL_RETURN(true)
+    }
+    /* append changes unless the journal outgrew the compacted file */
+    if(m_journal_valid&&
+       !m_db->requires_full_save()&&
+       QFileInfo(journal_filename(m_filename)).size()<=QFileInfo(m_filename).size()) {
+        if(append_journal()) {
+            emit saved(true);
+            LOG_BOOL_RETURN(true)
+        }
+        LOG_WARNING("failed to append journal, falling back to a full save.")
+    }
+    LOG_BOOL_RETURN(save_db_as(m_filename))
+}
+
+bool PicsouModelService::compact_db()
+{
+    LOG_IN_VOID()
+    LOG_BOOL_RETURN(save_db_as(m_filename))
+}
+
+bool PicsouModelService::save_db_as(QString filename)
+{
+    LOG_IN("filename="<<filename)
+    if(!is_db_opened()) {
+        LOG_BOOL_RETURN(false)
+    }
+    if(is_db_saving()) {
+        /* started once current save completes rather than blocking the UI */
+        m_save_pending=true;
+        m_pending_filename=filename;
+        LOG_BOOL_RETURN(true)
+    }
+    /* journal of previous generation becomes stale as soon as the file is rewritten */
+    m_journal_valid=false;
+    m_db->next_generation();
+    PicsouDB::Snapshot snapshot;
+    if(!m_db->snapshot(snapshot)) {
+        m_db->require_full_save();
+        LOG_BOOL_RETURN(false)
+    }
+    /* snapshot is taken, changes made from now on belong to the next save */
+    m_saving_count=m_modification_count;
+    m_saving_filename=filename;
+    m_db->mark_saved();
+    m_save_watcher.setFuture(QtConcurrent::run(write_db_file, snapshot, filename));
     LOG_BOOL_RETURN(true)
 }
 
+bool PicsouModelService::is_db_saving() const
+{
+    return !m_saving_filename.isNull();
+}
+
+void PicsouModelService::wait_for_save()
+{
+    LOG_IN_VOID()
+    while(is_db_saving()) {
+        m_save_watcher.waitForFinished();
+        save_finished();
+    }
+    LOG_VOID_RETURN()
+}
+
+void PicsouModelService::save_finished()
+{
+    LOG_IN_VOID()
+    /* completion may already have been handled by wait_for_save() */
+    if(!is_db_saving()||!m_save_watcher.future().isFinished()) {
+        LOG_VOID_RETURN()
+    }
+    QString filename=m_saving_filename;
+    m_saving_filename=QString();
+    bool success=m_save_watcher.result();
+    if(success) {
+        m_filename=filename;
+        m_is_db_modified=(m_modification_count!=m_saving_count);
+        m_journal_valid=reset_journal(filename);
+        if(!m_journal_valid) {
+            LOG_WARNING("failed to reset journal, next save will be a full save.")
+        }
+    } else {
+        /* changes collected in the snapshot are only in memory now */
+        LOG_CRITICAL("failed to write database file.")
+        m_db->require_full_save();
+        m_is_db_modified=true;
+    }
+    emit saved(success);
+    if(m_save_pending) {
+        m_save_pending=false;
+        QString pending_filename=m_pending_filename;
+        m_pending_filename=QString();
+        if(!(pending_filename.isNull()?save_db():save_db_as(pending_filename))) {
+            emit saved(false);
+        }
+    }
+    LOG_VOID_RETURN()
+}
+
 bool PicsouModelService::close_db()
 {
     LOG_IN_VOID()
     if(is_db_opened()) {
+        wait_for_save();
         m_filename.clear();
         m_is_db_modified=false;
+        m_journal_valid=false;
         m_db.clear();
+        /* decrypted names must not outlive the database */
+        Operation::clear_symbols();
         LOG_BOOL_RETURN(true)
     }
     LOG_BOOL_RETURN(false)
@@ -251,11 +597,76 @@ AccountShPtr PicsouModelService::find_account(QUuid id) const
     return account;
 }
 
-void PicsouModelService::dbo_modified()
+QFuture<PicsouDBO::Decrypted> PicsouModelService::decrypt_users(const UserShPtrList &users,
+                                                                const QStringList &pswds)
 {
-    LOG_IN_VOID()
+    LOG_IN("users.length="<<users.length()<<",pswds")
+    /* key derivation and decryption of each user run concurrently */
+    QList<UserDecryptTask> tasks;
+    for(int i=0; i<users.length()&&i<pswds.length(); ++i) {
+        tasks.append(UserDecryptTask(users.at(i), pswds.at(i)));
+    }
+    return QtConcurrent::mapped(tasks, UserDecryptor());
+}
+
+UserShPtrList PicsouModelService::publish_users(const UserShPtrList &users,
+                                                const QList<PicsouDBO::Decrypted> &decrypted)
+{
+    LOG_IN("users.length="<<users.length()<<",decrypted.length="<<decrypted.length())
+    UserShPtrList published;
+    /* objects are built on this thread once every user has been decrypted */
+    for(int i=0; i<users.length()&&i<decrypted.length(); ++i) {
+        if(!users.at(i)->publish(decrypted.at(i))) {
+            LOG_WARNING("failed to publish user: "<<users.at(i)->name())
+            continue;
+        }
+        published.append(users.at(i));
+    }
+    prefetch_segments(published);
+    LOG_DEBUG("-> published.length="<<published.length())
+    return published;
+}
+
+void PicsouModelService::prefetch_segments(const UserShPtrList &users)
+{
+    LOG_IN("users.length="<<users.length())
+    QList<SegmentDecryptTask> tasks;
+    for(const auto &user : users) {
+        for(const auto &account : user->accounts()) {
+            if(!account->loaded()) {
+                tasks.append(SegmentDecryptTask{user, account, account->segment()});
+            }
+        }
+    }
+    if(tasks.isEmpty()) {
+        LOG_VOID_RETURN()
+    }
+    /* segments are decrypted in background, accounts accessed meanwhile load synchronously */
+    QFutureWatcher<ColumnarDocument> *watcher=new QFutureWatcher<ColumnarDocument>(this);
+    connect(watcher, &QFutureWatcher<ColumnarDocument>::finished, this, [this, watcher, tasks]() {
+        QStringList failed;
+        QList<ColumnarDocument> docs=watcher->future().results();
+        for(int i=0; i<tasks.length()&&i<docs.length(); ++i) {
+            if(!tasks.at(i).account->load(tasks.at(i).wseg, docs.at(i))) {
+                /* account is marked invalid, its operations are not shown as empty silently */
+                failed<<tasks.at(i).account->name();
+            }
+        }
+        watcher->deleteLater();
+        if(!failed.isEmpty()) {
+            emit segments_failed(failed);
+        }
+    });
+    watcher->setFuture(QtConcurrent::mapped(tasks, SegmentDecryptor()));
+    LOG_VOID_RETURN()
+}
+
+void PicsouModelService::dbo_modified(const ChangeSet &changes)
+{
+    LOG_IN("changes.ids.size="<<changes.ids().size())
     m_is_db_modified=true;
-    emit updated(m_db);
+    m_modification_count++;
+    emit updated(m_db, changes);
     LOG_VOID_RETURN()
 }
 
@@ -272,7 +683,7 @@ OperationCollection PicsouModelService::xml_load_ops(QFile &f)
     bool ok;
     int y,m,d;
     QDate date;
-    double amount;
+    Amount amount;
     OperationShPtr op;
     OperationCollection ops;
     QXmlStreamReader xml(&f);
@@ -287,7 +698,7 @@ OperationCollection PicsouModelService::xml_load_ops(QFile &f)
         case QXmlStreamReader::StartElement:
             if(xml.name()=="operation") {
                 attrs=xml.attributes();
-                amount=attrs.value(XML_ATTR_AMOUNT).toDouble(&ok);
+                amount=Amount::from_str(attrs.value(XML_ATTR_AMOUNT).toString(), &ok);
                 if(!ok) {
                     LOG_WARNING("-> XML import parsing error: invalid amount.")
                     ops.clear();
@@ -346,7 +757,7 @@ OperationCollection PicsouModelService::csv_load_ops(QFile &f)
 {
     LOG_IN("&f="<<&f)
     QDate date;
-    double amount=0.0;
+    Amount amount;
     bool ok, instr;
     QByteArray line;
     OperationShPtr op;
@@ -391,7 +802,7 @@ OperationCollection PicsouModelService::csv_load_ops(QFile &f)
                             }
                             break;
                         case 3: /* amount */
-                            amount=buffer.toDouble(&ok);
+                            amount=Amount::from_str(buffer, &ok);
                             if(!ok) {
                                 LOG_WARNING("-> CSV import parsing error: invalid amount.")
                                 ops.clear();
@@ -498,9 +909,9 @@ bool PicsouModelService::csv_dump_ops(QFile &f, OperationCollection ops)
                     QString::number(op->date().day()),
                     op->amount().to_str(),
                     op->budget().replace('"', '\''),
-                    op->srcdst().replace('"', '\''),
+                    QString(op->srcdst()).replace('"', '\''),
                     op->payment_method().replace('"', '\''),
-                    op->description().replace('"', '\'').replace('\n', ';'))
+                    QString(op->description()).replace('"', '\'').replace('\n', ';'))
                 .toUtf8());
     }
     LOG_BOOL_RETURN(true)
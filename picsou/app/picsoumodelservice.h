@@ -20,6 +20,9 @@
 
 #include <QFile>
 #include <QUuid>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QJsonDocument>
 
 #include "model/object/picsoudb.h"
 #include "picsouabstractservice.h"
@@ -46,8 +49,10 @@ public:
     bool open_db(QString filename);
     bool save_db();
     bool save_db_as(QString filename);
+    bool compact_db();
     bool close_db();
     bool is_db_opened();
+    bool is_db_saving() const;
 
     OperationCollection load_ops(ImportExportFormat fmt,
                                  QString filename,
@@ -63,15 +68,35 @@ public:
     UserShPtr find_user(QUuid id) const;
     AccountShPtr find_account(QUuid id) const;
 
+    QFuture<PicsouDBO::Decrypted> decrypt_users(const UserShPtrList &users,
+                                                const QStringList &pswds);
+    /* returns the users which were published, others failed to unwrap */
+    UserShPtrList publish_users(const UserShPtrList &users,
+                                const QList<PicsouDBO::Decrypted> &decrypted);
+
 signals:
-    void updated(const PicsouDBShPtr db);
+    void updated(const PicsouDBShPtr db, const ChangeSet &changes);
     void unwrapped(const PicsouDBShPtr db);
+    void saved(bool success);
+    void segments_failed(const QStringList &accounts);
 
 public slots:
-    void dbo_modified();
+    void dbo_modified(const ChangeSet &changes);
     void dbo_unwrapped();
 
+private slots:
+    void save_finished();
+
 private:
+    bool read_newest_db_file(const QString &filename, QJsonDocument &doc);
+    bool read_db_file(const QString &filename, QJsonDocument &doc);
+    bool read_db_file(QFile &f, QJsonDocument &doc);
+    bool read_journal(const QString &filename);
+    bool reset_journal(const QString &filename);
+    bool append_journal();
+    void wait_for_save();
+    void prefetch_segments(const UserShPtrList &users);
+
     OperationCollection xml_load_ops(QFile &f);
     OperationCollection csv_load_ops(QFile &f);
     OperationCollection json_load_ops(QFile &f);
@@ -84,6 +109,14 @@ private:
     PicsouDBShPtr m_db;
     QString m_filename;
     bool m_is_db_modified;
+    bool m_journal_valid;
+    quint64 m_modification_count;
+    quint64 m_saving_count;
+    QString m_saving_filename;
+    bool m_save_pending;
+    /* target of a save_db_as() requested while saving, null for save_db() */
+    QString m_pending_filename;
+    QFutureWatcher<bool> m_save_watcher;
 
 };
 
@@ -24,6 +24,8 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QInputDialog>
+#include <QEventLoop>
+#include <QFutureWatcher>
 #include <QProgressDialog>
 #include <QDesktopServices>
 #include <QtConcurrent>
@@ -66,6 +68,21 @@ PicsouUIService::PicsouUIService(PicsouApplication *papp) :
 {
     LOG_IN("papp="<<papp)
     m_mw=new MainWindow(this);
+    m_search_progress=new QProgressDialog(m_mw);
+    m_search_progress->setWindowModality(Qt::WindowModal);
+    m_search_progress->setCancelButtonText(tr("Abort search"));
+    m_search_progress->setMinimumDuration(0);
+    m_search_progress->reset();
+    m_search_matches=0;
+    connect(&m_search_watcher, &QFutureWatcher<OperationCollection>::resultsReadyAt,
+            this, &PicsouUIService::search_results_at);
+    connect(&m_search_watcher, &QFutureWatcher<OperationCollection>::finished,
+            this, &PicsouUIService::search_done);
+    connect(&m_search_watcher, &QFutureWatcher<OperationCollection>::progressRangeChanged,
+            m_search_progress, &QProgressDialog::setRange);
+    connect(&m_search_watcher, &QFutureWatcher<OperationCollection>::progressValueChanged,
+            m_search_progress, &QProgressDialog::setValue);
+    connect(m_search_progress, &QProgressDialog::canceled, this, &PicsouUIService::search_cancel);
     LOG_VOID_RETURN()
 }
 
@@ -74,12 +91,16 @@ bool PicsouUIService::initialize()
     LOG_IN_VOID()
     connect(papp()->model_svc(), &PicsouModelService::updated, this, &PicsouUIService::notified_model_updated);
     connect(papp()->model_svc(), &PicsouModelService::unwrapped, this, &PicsouUIService::notified_model_unwrapped);
+    connect(papp()->model_svc(), &PicsouModelService::saved, this, &PicsouUIService::notified_model_saved);
+    connect(papp()->model_svc(), &PicsouModelService::segments_failed, this, &PicsouUIService::notified_segments_failed);
     LOG_BOOL_RETURN(true)
 }
 
 void PicsouUIService::terminate()
 {
     LOG_IN_VOID()
+    m_search_watcher.cancel();
+    m_search_watcher.waitForFinished();
     LOG_VOID_RETURN()
 }
 
@@ -298,51 +319,147 @@ bool PicsouUIService::populate_pms_list(const QString &username,
     LOG_BOOL_RETURN(found)
 }
 
-OperationCollection PicsouUIService::search_operations(const SearchQuery &query)
+bool PicsouUIService::populate_all_budgets_list(QListWidget * const list)
+{
+    LOG_IN("list="<<list)
+    QSet<QString> names;
+    for(const auto &user : papp()->model_svc()->db()->users()) {
+        if(!user->wrapped()) {
+            names+=QSet<QString>::fromList(user->budgets_str());
+        }
+    }
+    QStringList sorted=names.toList();
+    sorted.sort();
+    list->addItems(sorted);
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouUIService::populate_all_pms_list(QListWidget * const list)
+{
+    LOG_IN("list="<<list)
+    QSet<QString> names;
+    for(const auto &user : papp()->model_svc()->db()->users()) {
+        if(user->wrapped()) {
+            continue;
+        }
+        for(const auto &account : user->accounts()) {
+            names+=QSet<QString>::fromList(account->payment_methods_str());
+        }
+    }
+    QStringList sorted=names.toList();
+    sorted.sort();
+    list->addItems(sorted);
+    LOG_BOOL_RETURN(true)
+}
+
+/* operations handed to a single search worker, large accounts are split so
+   that a search scales with the cores rather than with the accounts, small
+   chunks keep the first results and cancellation responsive */
+static const int SEARCH_CHUNK_SIZE=1024;
+
+bool PicsouUIService::search_operations(const SearchQuery &query)
 {
     LOG_IN("query="<<&query)
-    OperationCollection ops;
-    QFuture<OperationShPtr> future;
-    UserShPtr user=papp()->model_svc()->db()->find_user(query.username());
-    if(!user.isNull()&&!user->wrapped()) {
-        LOG_DEBUG("found username: "<<user->name())
-        for(const auto &account : user->accounts(true)) {
-            if(account->name()==query.account_name()) {
-                LOG_DEBUG("found account: "<<account->name())
-                OperationCollection ops_col=papp()->model_svc()->db()->ops(account->id());
-                OperationShPtrList ops_list=ops_col.list(false);
-                LOG_DEBUG("searching among "<<ops_list.length()<<" operations")
-                future=QtConcurrent::filtered(ops_list.begin(), ops_list.end(), SearchQueryFilter(query));
-                LOG_DEBUG("future min: "<<future.progressMinimum())
-                LOG_DEBUG("future max: "<<future.progressMaximum())
-                QProgressDialog progress(tr("Searching among %0 operations...").arg(ops_list.length()),
-                                         tr("Abort search"),
-                                         future.progressMinimum(),
-                                         future.progressMaximum(),
-                                         m_mw);
-                progress.setWindowModality(Qt::WindowModal);
-                while(!future.isFinished()) {
-                    LOG_DEBUG("searching the dataset...")
-                    progress.setValue(future.progressValue());
-                    if (progress.wasCanceled()) {
-                        future.cancel();
-                        LOG_WARNING("search cancelled.")
-                        return ops;
-                    }
-                    QThread::msleep(100);
+    /* results of a previous search still running are discarded */
+    search_cancel();
+    m_search_watcher.waitForFinished();
+    PicsouDBShPtr db=papp()->model_svc()->db();
+    AccountShPtrList accounts;
+    if(query.all_accounts()) {
+        for(const auto &user : db->users(true)) {
+            if(!user->wrapped()) {
+                accounts+=user->accounts(true);
+            }
+        }
+    } else {
+        UserShPtr user=db->find_user(query.username());
+        if(!user.isNull()&&!user->wrapped()) {
+            LOG_DEBUG("found username: "<<user->name())
+            for(const auto &account : user->accounts(true)) {
+                if(account->name()==query.account_name()) {
+                    LOG_DEBUG("found account: "<<account->name())
+                    accounts.append(account);
+                    break;
                 }
-                progress.setValue(future.progressValue());
-                ops=future.results();
-                LOG_DEBUG("search successful! (results count: "<<ops.length()<<")")
-                break;
             }
         }
     }
-    if(ops.length()==0) {
+    /* account caches are not thread-safe: collections and description indexes
+       are built here and workers only read operations, the progress dialog is
+       modal so that the model is not modified while they run */
+    QList<SearchChunk> chunks;
+    int searched=0;
+    for(const auto &account : accounts) {
+        OperationCollection ops_col=db->ops(account->id());
+        /* date, amount and description indexes narrow the operations to check,
+           scheduled occurrences are filtered without being instanciated */
+        OperationShPtrList ops_list=account->search_candidates(query);
+        searched+=ops_list.length()+ops_col.occurrences().size();
+        SearchChunk chunk;
+        chunk.occurrences=ops_col.occurrences();
+        for(int i=0; i<ops_list.length(); i+=SEARCH_CHUNK_SIZE) {
+            chunk.ops=ops_list.mid(i, SEARCH_CHUNK_SIZE);
+            chunks.append(chunk);
+            chunk.occurrences.clear();
+        }
+        if(!chunk.occurrences.isEmpty()) {
+            chunks.append(chunk);
+        }
+    }
+    m_search_matches=0;
+    if(chunks.isEmpty()) {
+        /* nothing to search, the UI waits for the search to finish all the same */
+        finish_search(false);
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_DEBUG("searching among "<<searched<<" operations of "<<accounts.length()<<" accounts")
+    m_search_progress->setLabelText(tr("Searching among %0 operations...").arg(searched));
+    m_search_progress->setRange(0, chunks.length());
+    m_search_progress->setValue(0);
+    m_search_progress->show();
+    m_search_watcher.setFuture(QtConcurrent::mapped(chunks, SearchQueryMapper(query)));
+    LOG_BOOL_RETURN(true)
+}
+
+void PicsouUIService::search_cancel()
+{
+    LOG_IN_VOID()
+    if(m_search_watcher.isRunning()) {
+        /* pending chunks are dropped, running ones complete at most one chunk */
+        m_search_watcher.cancel();
+        LOG_WARNING("search cancelled.")
+    }
+    LOG_VOID_RETURN()
+}
+
+void PicsouUIService::search_results_at(int begin, int end)
+{
+    for(int i=begin; i<end; ++i) {
+        OperationCollection matches=m_search_watcher.resultAt(i);
+        if(matches.length()>0) {
+            m_search_matches+=matches.length();
+            emit search_results_ready(matches);
+        }
+    }
+}
+
+void PicsouUIService::search_done()
+{
+    LOG_IN_VOID()
+    m_search_progress->reset();
+    finish_search(m_search_watcher.isCanceled());
+    LOG_VOID_RETURN()
+}
+
+void PicsouUIService::finish_search(bool canceled)
+{
+    LOG_IN("canceled="<<canceled)
+    LOG_DEBUG("search done! (results count: "<<m_search_matches<<")")
+    if(!canceled&&m_search_matches==0) {
         QMessageBox::information(m_mw, tr("No result"), tr("No operation matched the search query."));
     }
-    LOG_DEBUG("-> ops.length="<<ops.length())
-    return ops;
+    emit search_finished(canceled);
+    LOG_VOID_RETURN()
 }
 
 BudgetShPtrList PicsouUIService::user_budgets(const QString &name)
@@ -355,6 +472,17 @@ BudgetShPtrList PicsouUIService::user_budgets(const QString &name)
     return user->budgets();
 }
 
+BudgetShPtrList PicsouUIService::unlocked_budgets()
+{
+    BudgetShPtrList budgets;
+    for(const auto &user : papp()->model_svc()->db()->users()) {
+        if(!user->wrapped()) {
+            budgets+=user->budgets();
+        }
+    }
+    return budgets;
+}
+
 PicsouUIViewer *PicsouUIService::viewer_from_item(QTreeWidgetItem *item)
 {
     LOG_IN("item="<<item)
@@ -422,7 +550,7 @@ PicsouUIViewer *PicsouUIService::viewer_from_item(QTreeWidgetItem *item)
         }
     }
     /* trigger viewer content update */
-    emit notify_model_updated(papp()->model_svc()->db());
+    emit notify_model_updated(papp()->model_svc()->db(), ChangeSet::everything());
     LOG_DEBUG("-> w="<<w)
     return w;
 }
@@ -479,19 +607,75 @@ void PicsouUIService::unlock(QUuid id)
         emit svc_op_failed(tr("Failed to find user."));
         LOG_VOID_RETURN()
     }
-    QString pswd;
-    if(!prompt_for_pswd(user->name(), pswd)) {
-        emit svc_op_canceled();
+    unlock_users(UserShPtrList()<<user);
+    LOG_VOID_RETURN()
+}
+
+void PicsouUIService::unlock_all()
+{
+    LOG_IN_VOID()
+    if(!papp()->model_svc()->is_db_opened()) {
         LOG_VOID_RETURN()
     }
-    if(!user->unwrap(pswd)) {
-        emit svc_op_failed(tr("Failed to unwrap user."));
-        LOG_VOID_RETURN()
+    UserShPtrList users;
+    for(const auto &user : papp()->model_svc()->db()->users(true)) {
+        if(user->wrapped()) {
+            users.append(user);
+        }
     }
-    emit unlocked();
+    unlock_users(users);
     LOG_VOID_RETURN()
 }
 
+bool PicsouUIService::unlock_users(const UserShPtrList &users)
+{
+    LOG_IN("users.length="<<users.length())
+    QString pswd;
+    QStringList pswds;
+    UserShPtrList prompted;
+    for(const auto &user : users) {
+        if(!prompt_for_pswd(user->name(), pswd)) {
+            continue;
+        }
+        prompted.append(user);
+        pswds.append(pswd);
+    }
+    if(prompted.isEmpty()) {
+        emit svc_op_canceled();
+        LOG_BOOL_RETURN(false)
+    }
+    /* users are decrypted concurrently while the event loop keeps the window responsive */
+    QFutureWatcher<PicsouDBO::Decrypted> watcher;
+    QEventLoop loop;
+    QProgressDialog progress(tr("Unlocking %0 user(s)...").arg(prompted.length()),
+                             QString(),
+                             0,
+                             0,
+                             m_mw);
+    progress.setWindowModality(Qt::WindowModal);
+    connect(&watcher, &QFutureWatcher<PicsouDBO::Decrypted>::finished, &loop, &QEventLoop::quit);
+    watcher.setFuture(papp()->model_svc()->decrypt_users(prompted, pswds));
+    progress.show();
+    loop.exec();
+    progress.close();
+    UserShPtrList published=papp()->model_svc()->publish_users(prompted, watcher.future().results());
+    if(!published.isEmpty()) {
+        /* tree and viewers are refreshed for users which were published */
+        emit unlocked();
+    }
+    if(published.length()<prompted.length()) {
+        QStringList failed;
+        for(const auto &user : prompted) {
+            if(!published.contains(user)) {
+                failed<<user->name();
+            }
+        }
+        emit svc_op_failed(tr("Failed to unwrap user(s): %0.").arg(failed.join(", ")));
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_BOOL_RETURN(true)
+}
+
 void PicsouUIService::db_new()
 {
     LOG_IN_VOID()
@@ -576,8 +760,8 @@ void PicsouUIService::db_close()
 void PicsouUIService::db_save()
 {
     LOG_IN_VOID()
+    /* completion is notified through notified_model_saved() */
     if(papp()->model_svc()->save_db()) {
-        emit db_saved();
         LOG_VOID_RETURN()
     }
     emit svc_op_failed(tr("Failed to save the database properly."));
@@ -594,7 +778,6 @@ void PicsouUIService::db_save_as()
             LOG_VOID_RETURN()
         }
         if(papp()->model_svc()->save_db_as(filename)) {
-            emit db_saved();
             LOG_VOID_RETURN()
         }
     }
@@ -602,6 +785,16 @@ void PicsouUIService::db_save_as()
     LOG_VOID_RETURN()
 }
 
+void PicsouUIService::db_compact()
+{
+    LOG_IN_VOID()
+    if(papp()->model_svc()->compact_db()) {
+        LOG_VOID_RETURN()
+    }
+    emit svc_op_failed(tr("Failed to compact the database properly."));
+    LOG_VOID_RETURN()
+}
+
 void PicsouUIService::user_add()
 {
     LOG_IN_VOID()
@@ -1178,48 +1371,52 @@ void PicsouUIService::transfer_add(QUuid user_id)
         emit svc_op_failed(tr("Invalid account pointer (sender and/or recipient)."));
         LOG_VOID_RETURN()
     }
-    QString error;
-    if(dialog.scheduled()) {
-        if(!sender_acc->add_scheduled_operation(-dialog.amount(),
-                                                QString(""),
-                                                recipient_acc->name(),
-                                                dialog.description(),
-                                                tr("Transfer"),
-                                                tr("Transfer to %0").arg(recipient_acc->name()),
-                                                dialog.schedule(), error)) {
-            emit svc_op_failed(error);
-            LOG_VOID_RETURN()
-        }
-        if(!recipient_acc->add_scheduled_operation(dialog.amount(),
-                                                   QString(""),
-                                                   sender_acc->name(),
-                                                   dialog.description(),
-                                                   tr("Transfer"),
-                                                   tr("Transfer from %0").arg(sender_acc->name()),
-                                                   dialog.schedule(), error)) {
-            emit svc_op_failed(error);
-            LOG_VOID_RETURN()
-        }
-    } else {
-        if(!sender_acc->add_operation(false,
-                                      -dialog.amount(),
-                                      dialog.date(),
-                                      QString(""),
-                                      recipient_acc->name(),
-                                      tr("Transfer to %0").arg(recipient_acc->name()),
-                                      tr("Transfer"), error)) {
-            emit svc_op_failed(error);
-            LOG_VOID_RETURN()
-        }
-        if(!recipient_acc->add_operation(false,
-                                         dialog.amount(),
-                                         dialog.date(),
-                                         QString(""),
-                                         sender_acc->name(),
-                                         tr("Transfer from %0").arg(sender_acc->name()),
-                                         tr("Transfer"), error)) {
-            emit svc_op_failed(error);
-            LOG_VOID_RETURN()
+    {
+        /* both accounts are refreshed once */
+        PicsouDBBatch batch(papp()->model_svc()->db());
+        QString error;
+        if(dialog.scheduled()) {
+            if(!sender_acc->add_scheduled_operation(-dialog.amount(),
+                                                    QString(""),
+                                                    recipient_acc->name(),
+                                                    dialog.description(),
+                                                    tr("Transfer"),
+                                                    tr("Transfer to %0").arg(recipient_acc->name()),
+                                                    dialog.schedule(), error)) {
+                emit svc_op_failed(error);
+                LOG_VOID_RETURN()
+            }
+            if(!recipient_acc->add_scheduled_operation(dialog.amount(),
+                                                       QString(""),
+                                                       sender_acc->name(),
+                                                       dialog.description(),
+                                                       tr("Transfer"),
+                                                       tr("Transfer from %0").arg(sender_acc->name()),
+                                                       dialog.schedule(), error)) {
+                emit svc_op_failed(error);
+                LOG_VOID_RETURN()
+            }
+        } else {
+            if(!sender_acc->add_operation(false,
+                                          -dialog.amount(),
+                                          dialog.date(),
+                                          QString(""),
+                                          recipient_acc->name(),
+                                          tr("Transfer to %0").arg(recipient_acc->name()),
+                                          tr("Transfer"), error)) {
+                emit svc_op_failed(error);
+                LOG_VOID_RETURN()
+            }
+            if(!recipient_acc->add_operation(false,
+                                             dialog.amount(),
+                                             dialog.date(),
+                                             QString(""),
+                                             sender_acc->name(),
+                                             tr("Transfer from %0").arg(sender_acc->name()),
+                                             tr("Transfer"), error)) {
+                emit svc_op_failed(error);
+                LOG_VOID_RETURN()
+            }
         }
     }
     QMessageBox::information(m_mw, tr("Transfer successful"),
@@ -1228,14 +1425,32 @@ void PicsouUIService::transfer_add(QUuid user_id)
     LOG_VOID_RETURN()
 }
 
-void PicsouUIService::notified_model_updated(const PicsouDBShPtr db)
+void PicsouUIService::notified_model_updated(const PicsouDBShPtr db, const ChangeSet &changes)
 {
     LOG_IN_VOID()
-    emit notify_model_updated(db);
+    emit notify_model_updated(db, changes);
     emit db_modified();
     LOG_VOID_RETURN()
 }
 
+void PicsouUIService::notified_model_saved(bool success)
+{
+    LOG_IN("success="<<success)
+    if(success) {
+        emit db_saved();
+        LOG_VOID_RETURN()
+    }
+    emit svc_op_failed(tr("Failed to save the database properly."));
+    LOG_VOID_RETURN()
+}
+
+void PicsouUIService::notified_segments_failed(const QStringList &accounts)
+{
+    LOG_IN("accounts="<<accounts)
+    emit svc_op_failed(tr("Failed to decrypt operations of account(s): %0.").arg(accounts.join(", ")));
+    LOG_VOID_RETURN()
+}
+
 void PicsouUIService::notified_model_unwrapped(const PicsouDBShPtr db)
 {
     LOG_IN_VOID()
@@ -18,6 +18,8 @@
 #ifndef PICSOUUISERVICE_H
 #define PICSOUUISERVICE_H
 
+#include <QFutureWatcher>
+
 #include "picsouabstractservice.h"
 #include "model/object/picsoudb.h"
 #include "model/searchquery.h"
@@ -28,6 +30,7 @@ class QListWidget;
 class QTreeWidget;
 class QTableWidget;
 class PicsouUIViewer;
+class QProgressDialog;
 class QTreeWidgetItem;
 
 class PicsouUIService : public PicsouAbstractService
@@ -49,9 +52,15 @@ public:
     bool populate_account_cb(const QString &username, QComboBox* const cb);
     bool populate_budgets_list(const QString &username, QListWidget* const list);
     bool populate_pms_list(const QString &username, const QString &account_name, QListWidget* const list);
+    /* names used by every unlocked user */
+    bool populate_all_budgets_list(QListWidget* const list);
+    bool populate_all_pms_list(QListWidget* const list);
 
-    OperationCollection search_operations(const SearchQuery &query);
+    /* matches are streamed through search_results_ready, search_finished
+       is emitted once every worker stopped */
+    bool search_operations(const SearchQuery &query);
     BudgetShPtrList user_budgets(const QString &name);
+    BudgetShPtrList unlocked_budgets();
 
     PicsouUIViewer *viewer_from_item(QTreeWidgetItem *item);
 
@@ -59,7 +68,10 @@ signals:
     void svc_op_failed(QString error);
     void svc_op_canceled();
 
-    void notify_model_updated(const PicsouDBShPtr db);
+    void search_results_ready(const OperationCollection &ops);
+    void search_finished(bool canceled);
+
+    void notify_model_updated(const PicsouDBShPtr db, const ChangeSet &changes);
     void notify_model_unwrapped(const PicsouDBShPtr db);
 
     void unlocked();
@@ -110,6 +122,7 @@ public slots:
     void show_license();
     /* Encryption-related */
     void unlock(QUuid id);
+    void unlock_all();
     /* DB ops */
     void db_new();
     void db_open();
@@ -117,6 +130,7 @@ public slots:
     void db_close();
     void db_save();
     void db_save_as();
+    void db_compact();
     /* User ops */
     void user_add();
     void user_edit(QUuid id);
@@ -148,17 +162,30 @@ public slots:
     /* Transfer */
     void transfer_add(QUuid user_id);
     /* Handle model notifications */
-    void notified_model_updated(const PicsouDBShPtr db);
+    void notified_model_updated(const PicsouDBShPtr db, const ChangeSet &changes);
     void notified_model_unwrapped(const PicsouDBShPtr db);
+    void notified_model_saved(bool success);
+    void notified_segments_failed(const QStringList &accounts);
+    /* Search */
+    void search_cancel();
+
+private slots:
+    void search_results_at(int begin, int end);
+    void search_done();
 
 private:
     bool close_any_opened_db();
+    bool unlock_users(const UserShPtrList &users);
+    void finish_search(bool canceled);
 
 private:
     int m_prev_year;
     int m_prev_month;
     QUuid m_prev_id;
     MainWindow *m_mw;
+    QProgressDialog *m_search_progress;
+    QFutureWatcher<OperationCollection> m_search_watcher;
+    int m_search_matches;
 };
 
 #include <QPointer>
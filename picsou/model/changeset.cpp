@@ -0,0 +1,63 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "changeset.h"
+
+ChangeSet::ChangeSet(bool all) :
+    m_all(all)
+{
+
+}
+
+ChangeSet ChangeSet::everything()
+{
+    return ChangeSet(true);
+}
+
+void ChangeSet::insert(QUuid id)
+{
+    m_ids.insert(id);
+}
+
+void ChangeSet::insert_budgets_of(QUuid user_id)
+{
+    m_budget_owners.insert(user_id);
+}
+
+void ChangeSet::unite(const ChangeSet &other)
+{
+    m_all=m_all||other.m_all;
+    m_ids.unite(other.m_ids);
+    m_budget_owners.unite(other.m_budget_owners);
+}
+
+void ChangeSet::clear()
+{
+    m_all=false;
+    m_ids.clear();
+    m_budget_owners.clear();
+}
+
+bool ChangeSet::contains(QUuid id) const
+{
+    return m_all||m_ids.contains(id);
+}
+
+bool ChangeSet::budgets_changed(QUuid user_id) const
+{
+    return m_all||m_budget_owners.contains(user_id);
+}
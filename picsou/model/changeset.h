@@ -0,0 +1,51 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef CHANGESET_H
+#define CHANGESET_H
+
+#include <QSet>
+#include <QUuid>
+
+/* identifiers of the objects modified by a mutation or a batch of mutations,
+   an object is listed along with all its ancestors */
+class ChangeSet
+{
+public:
+    ChangeSet(bool all=false);
+
+    static ChangeSet everything();
+
+    void insert(QUuid id);
+    /* budgets of a user were added, modified or removed, removed ones are no
+       longer reachable from the user */
+    void insert_budgets_of(QUuid user_id);
+    void unite(const ChangeSet &other);
+    void clear();
+
+    bool contains(QUuid id) const;
+    bool budgets_changed(QUuid user_id) const;
+    inline bool empty() const { return !m_all&&m_ids.isEmpty(); }
+    inline QSet<QUuid> ids() const { return m_ids; }
+
+private:
+    bool m_all;
+    QSet<QUuid> m_ids;
+    QSet<QUuid> m_budget_owners;
+};
+
+#endif // CHANGESET_H
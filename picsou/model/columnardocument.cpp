@@ -0,0 +1,370 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "columnardocument.h"
+#include "utils/macro.h"
+
+#include <QHash>
+#include <QVector>
+#include <QtEndian>
+#include <QJsonDocument>
+
+const QByteArray ColumnarDocument::MAGIC=QByteArray("PSCD");
+const quint32 ColumnarDocument::VERSION=2;
+
+static const int ALIGNMENT=8;
+static const int UUID_SIZE=16;
+
+template<typename T>
+static void put(QByteArray &buf, T value)
+{
+    uchar bytes[sizeof(T)];
+    qToLittleEndian<T>(value, bytes);
+    buf.append(reinterpret_cast<const char*>(bytes), sizeof(T));
+}
+
+template<typename T>
+static T get(const char *base, int index)
+{
+    return qFromLittleEndian<T>(reinterpret_cast<const uchar*>(base)+index*static_cast<int>(sizeof(T)));
+}
+
+static void pad(QByteArray &buf)
+{
+    while(buf.size()%ALIGNMENT!=0) {
+        buf.append('\0');
+    }
+}
+
+static void put_strings(QByteArray &buf, const QStringList &strings)
+{
+    QByteArray blob;
+    put<quint32>(buf, static_cast<quint32>(strings.size()));
+    put<quint32>(buf, 0);
+    for(const auto &str : strings) {
+        blob.append(str.toUtf8());
+        put<quint32>(buf, static_cast<quint32>(blob.size()));
+    }
+    pad(buf);
+    buf.append(blob);
+    pad(buf);
+}
+
+static void put_indices(QByteArray &buf, const QVector<quint32> &indices)
+{
+    for(auto idx : indices) {
+        put<quint32>(buf, idx);
+    }
+    pad(buf);
+}
+
+static quint32 dict_index(QHash<QString, quint32> &index,
+                          QStringList &dict,
+                          const QString &value)
+{
+    QHash<QString, quint32>::const_iterator it=index.constFind(value);
+    if(it!=index.constEnd()) {
+        return it.value();
+    }
+    quint32 idx=static_cast<quint32>(dict.size());
+    index.insert(value, idx);
+    dict.append(value);
+    return idx;
+}
+
+static void put_block(QByteArray &buf, const OperationShPtrList &ops)
+{
+    QStringList budgets, pms, srcdsts, descriptions;
+    QHash<QString, quint32> budget_index, pm_index, srcdst_index;
+    QVector<quint32> budget_idx, pm_idx, srcdst_idx;
+    budget_idx.reserve(ops.size());
+    pm_idx.reserve(ops.size());
+    srcdst_idx.reserve(ops.size());
+    for(const auto &op : ops) {
+        budget_idx.append(dict_index(budget_index, budgets, op->budget()));
+        pm_idx.append(dict_index(pm_index, pms, op->payment_method()));
+        srcdst_idx.append(dict_index(srcdst_index, srcdsts, op->srcdst()));
+        descriptions.append(op->description());
+    }
+    put<quint32>(buf, static_cast<quint32>(ops.size()));
+    put<quint32>(buf, 0);
+    for(const auto &op : ops) {
+        buf.append(op->id().toRfc4122());
+    }
+    for(const auto &op : ops) {
+        put<qint64>(buf, op->amount().minor_units());
+    }
+    for(const auto &op : ops) {
+        put<qint32>(buf, static_cast<qint32>(op->date().toJulianDay()));
+    }
+    pad(buf);
+    for(const auto &op : ops) {
+        buf.append(op->verified()?'\1':'\0');
+    }
+    pad(buf);
+    put_strings(buf, budgets);
+    put_indices(buf, budget_idx);
+    put_strings(buf, pms);
+    put_indices(buf, pm_idx);
+    put_strings(buf, srcdsts);
+    put_indices(buf, srcdst_idx);
+    put_strings(buf, descriptions);
+}
+
+/* bounds-checked cursor over a columnar buffer */
+class ColumnReader
+{
+public:
+    ColumnReader(const QByteArray &data) :
+        m_data(data.constData()),
+        m_size(data.size()),
+        m_pos(0),
+        m_ok(true)
+    {
+
+    }
+
+    inline bool ok() const { return m_ok; }
+
+    const char *take(qint64 count, qint64 size=1)
+    {
+        if(!m_ok||count<0||(size>0&&count>(m_size-m_pos)/size)) {
+            m_ok=false;
+            return nullptr;
+        }
+        const char *ptr=m_data+m_pos;
+        m_pos+=count*size;
+        return ptr;
+    }
+
+    quint32 u32()
+    {
+        const char *ptr=take(1, sizeof(quint32));
+        return (ptr==nullptr?0:get<quint32>(ptr, 0));
+    }
+
+    void align()
+    {
+        qint64 rem=m_pos%ALIGNMENT;
+        if(rem!=0) {
+            take(ALIGNMENT-rem);
+        }
+    }
+
+    /* reads an offset table and its blob, offsets are validated once here */
+    bool strings(quint32 &count, const char *&offsets, const char *&blob)
+    {
+        count=u32();
+        u32(); /* reserved */
+        offsets=take(count, sizeof(quint32));
+        align();
+        if(!m_ok) {
+            return false;
+        }
+        quint32 prev=0, cur;
+        for(quint32 i=0; i<count; ++i) {
+            cur=get<quint32>(offsets, static_cast<int>(i));
+            if(cur<prev) {
+                m_ok=false;
+                return false;
+            }
+            prev=cur;
+        }
+        blob=take(prev);
+        align();
+        return m_ok;
+    }
+
+    bool dict(QStringList &dict)
+    {
+        quint32 count;
+        const char *offsets, *blob;
+        if(!strings(count, offsets, blob)) {
+            return false;
+        }
+        quint32 begin=0, end;
+        for(quint32 i=0; i<count; ++i) {
+            end=get<quint32>(offsets, static_cast<int>(i));
+            dict.append(QString::fromUtf8(blob+begin, static_cast<int>(end-begin)));
+            begin=end;
+        }
+        return true;
+    }
+
+private:
+    const char *m_data;
+    qint64 m_size;
+    qint64 m_pos;
+    bool m_ok;
+};
+
+ColumnarDocument::Block::Block() :
+    m_count(0),
+    m_ids(nullptr),
+    m_days(nullptr),
+    m_amounts(nullptr),
+    m_verified(nullptr),
+    m_budget_idx(nullptr),
+    m_pm_idx(nullptr),
+    m_srcdst_idx(nullptr),
+    m_desc_offsets(nullptr),
+    m_desc_data(nullptr)
+{
+
+}
+
+QUuid ColumnarDocument::Block::id(int row) const
+{
+    return QUuid::fromRfc4122(QByteArray::fromRawData(m_ids+row*UUID_SIZE, UUID_SIZE));
+}
+
+QDate ColumnarDocument::Block::date(int row) const
+{
+    return QDate::fromJulianDay(get<qint32>(m_days, row));
+}
+
+Amount ColumnarDocument::Block::amount(int row) const
+{
+    return Amount::from_minor_units(get<qint64>(m_amounts, row));
+}
+
+bool ColumnarDocument::Block::verified(int row) const
+{
+    return m_verified[row]!='\0';
+}
+
+QString ColumnarDocument::Block::budget(int row) const
+{
+    return m_budgets.value(static_cast<int>(get<quint32>(m_budget_idx, row)));
+}
+
+QString ColumnarDocument::Block::srcdst(int row) const
+{
+    return m_srcdsts.value(static_cast<int>(get<quint32>(m_srcdst_idx, row)));
+}
+
+QString ColumnarDocument::Block::description(int row) const
+{
+    quint32 begin=(row==0?0:get<quint32>(m_desc_offsets, row-1));
+    quint32 end=get<quint32>(m_desc_offsets, row);
+    return QString::fromUtf8(m_desc_data+begin, static_cast<int>(end-begin));
+}
+
+QString ColumnarDocument::Block::payment_method(int row) const
+{
+    return m_pms.value(static_cast<int>(get<quint32>(m_pm_idx, row)));
+}
+
+bool ColumnarDocument::detect(const QByteArray &data)
+{
+    return data.startsWith(MAGIC);
+}
+
+QByteArray ColumnarDocument::encode(const QJsonObject &header,
+                                    const QList<OperationShPtrList> &blocks)
+{
+    LOG_IN("<QJsonObject>,blocks.length="<<blocks.length())
+    QByteArray jheader=QJsonDocument(header).toJson(QJsonDocument::Compact);
+    QByteArray buf=MAGIC;
+    put<quint32>(buf, VERSION);
+    put<quint32>(buf, static_cast<quint32>(jheader.size()));
+    put<quint32>(buf, static_cast<quint32>(blocks.size()));
+    buf.append(jheader);
+    pad(buf);
+    for(const auto &ops : blocks) {
+        put_block(buf, ops);
+    }
+    LOG_DEBUG("-> buf.size="<<buf.size())
+    return buf;
+}
+
+ColumnarDocument::ColumnarDocument() :
+    m_valid(false),
+    m_version(0)
+{
+
+}
+
+ColumnarDocument::ColumnarDocument(const QByteArray &data) :
+    m_valid(false),
+    m_version(0),
+    m_data(data)
+{
+    m_valid=parse();
+}
+
+bool ColumnarDocument::parse()
+{
+    LOG_IN_VOID()
+    ColumnReader rd(m_data);
+    const char *magic=rd.take(MAGIC.size());
+    if(magic==nullptr||QByteArray::fromRawData(magic, MAGIC.size())!=MAGIC) {
+        LOG_CRITICAL("invalid columnar document magic.")
+        LOG_BOOL_RETURN(false)
+    }
+    m_version=rd.u32();
+    if(m_version<1||m_version>VERSION) {
+        LOG_CRITICAL("unsupported columnar document version: "<<m_version)
+        LOG_BOOL_RETURN(false)
+    }
+    quint32 header_size=rd.u32();
+    quint32 block_cnt=rd.u32();
+    const char *jheader=rd.take(header_size);
+    rd.align();
+    if(!rd.ok()) {
+        LOG_CRITICAL("truncated columnar document header.")
+        LOG_BOOL_RETURN(false)
+    }
+    QJsonParseError err;
+    QJsonDocument doc=QJsonDocument::fromJson(QByteArray::fromRawData(jheader, static_cast<int>(header_size)), &err);
+    if(!doc.isObject()) {
+        LOG_CRITICAL("failed to parse columnar document header: "<<err.errorString())
+        LOG_BOOL_RETURN(false)
+    }
+    m_header=doc.object();
+    for(quint32 b=0; b<block_cnt; ++b) {
+        Block block;
+        quint32 desc_cnt;
+        quint32 count=rd.u32();
+        rd.u32(); /* reserved */
+        block.m_count=static_cast<int>(count);
+        if(m_version>=2) {
+            block.m_ids=rd.take(count, UUID_SIZE);
+        }
+        block.m_amounts=rd.take(count, sizeof(qint64));
+        block.m_days=rd.take(count, sizeof(qint32));
+        rd.align();
+        block.m_verified=rd.take(count);
+        rd.align();
+        rd.dict(block.m_budgets);
+        block.m_budget_idx=rd.take(count, sizeof(quint32));
+        rd.align();
+        rd.dict(block.m_pms);
+        block.m_pm_idx=rd.take(count, sizeof(quint32));
+        rd.align();
+        rd.dict(block.m_srcdsts);
+        block.m_srcdst_idx=rd.take(count, sizeof(quint32));
+        rd.align();
+        rd.strings(desc_cnt, block.m_desc_offsets, block.m_desc_data);
+        if(!rd.ok()||desc_cnt!=count) {
+            LOG_CRITICAL("truncated or corrupted column block.")
+            LOG_BOOL_RETURN(false)
+        }
+        m_blocks.append(block);
+    }
+    LOG_BOOL_RETURN(true)
+}
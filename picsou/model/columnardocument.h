@@ -0,0 +1,113 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef COLUMNARDOCUMENT_H
+#define COLUMNARDOCUMENT_H
+
+#include <QDate>
+#include <QList>
+#include <QUuid>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QStringList>
+
+#include "object/operation.h"
+
+/**
+ * @brief Binary columnar encoding of an unwrapped payload
+ * @details
+ *      A document is made of a compact JSON header followed by blocks of
+ *      operation columns, either one per account listed in the header or none
+ *      when operations are stored in per-account segments. Every column is
+ *      stored little-endian at an 8-byte aligned offset so that a block can
+ *      be read in place from the (decrypted or mapped) buffer. A block
+ *      starts with its uint32 row count and a reserved uint32, followed in
+ *      this order by:
+ *          - operation identifiers as RFC 4122 bytes (since version 2)
+ *          - amounts as int64 count of Amount minor units
+ *          - dates as int32 julian day numbers
+ *          - verified flags as one byte per operation
+ *          - budget, payment method and recipient, each as a dictionary
+ *            followed by uint32 indices into it
+ *          - descriptions as an offset table into a UTF-8 blob
+ */
+class ColumnarDocument
+{
+public:
+    class Block
+    {
+    public:
+        Block();
+
+        inline int count() const { return m_count; }
+        inline bool has_ids() const { return m_ids!=nullptr; }
+
+        QUuid id(int row) const;
+        QDate date(int row) const;
+        Amount amount(int row) const;
+        bool verified(int row) const;
+        QString budget(int row) const;
+        QString srcdst(int row) const;
+        QString description(int row) const;
+        QString payment_method(int row) const;
+
+    private:
+        friend class ColumnarDocument;
+
+        int m_count;
+        const char *m_ids;
+        const char *m_days;
+        const char *m_amounts;
+        const char *m_verified;
+        const char *m_budget_idx;
+        const char *m_pm_idx;
+        const char *m_srcdst_idx;
+        const char *m_desc_offsets;
+        const char *m_desc_data;
+        QStringList m_budgets;
+        QStringList m_pms;
+        QStringList m_srcdsts;
+    };
+
+    static const QByteArray MAGIC;
+    static const quint32 VERSION;
+
+    static bool detect(const QByteArray &data);
+    static QByteArray encode(const QJsonObject &header,
+                             const QList<OperationShPtrList> &blocks);
+
+    ColumnarDocument();
+    ColumnarDocument(const QByteArray &data);
+
+    inline bool valid() const { return m_valid; }
+    inline quint32 version() const { return m_version; }
+    inline QJsonObject header() const { return m_header; }
+    inline int block_count() const { return m_blocks.size(); }
+    inline const Block &block(int i) const { return m_blocks.at(i); }
+
+private:
+    bool parse();
+
+private:
+    bool m_valid;
+    quint32 m_version;
+    QByteArray m_data; /* keeps column pointers alive */
+    QJsonObject m_header;
+    QList<Block> m_blocks;
+};
+
+#endif // COLUMNARDOCUMENT_H
@@ -34,6 +34,8 @@ bool Converter::convert(QJsonDocument *doc, SemVer from, PicsouUIServicePtr ui_s
     QList<QPair<SemVer, db_converter_t>> converter_list;
     converter_list.append(makeConverterPair(SemVer(1, 0, 0), convert_100_110));
     converter_list.append(makeConverterPair(SemVer(1, 1, 0), convert_110_200));
+    converter_list.append(makeConverterPair(SemVer(2, 0, 0), convert_200_210));
+    converter_list.append(makeConverterPair(SemVer(2, 1, 0), convert_210_220));
     /* apply conversions */
     LOG_DEBUG("attempting conversion.")
     for(const auto &converter : converter_list) {
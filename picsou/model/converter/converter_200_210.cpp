@@ -0,0 +1,15 @@
+#include "converters.h"
+#include "utils/macro.h"
+#include "model/object/picsoudb.h"
+
+#include <QJsonObject>
+
+bool convert_200_210(QJsonDocument *doc, PicsouUIServicePtr)
+{
+    LOG_IN("doc="<<doc)
+    /* wrapped payloads are converted to columnar encoding on next unwrap+save */
+    QJsonObject db=doc->object();
+    db[PicsouDB::KW_VERSION]=SemVer(2, 1, 0).to_str();
+    doc->setObject(db);
+    LOG_BOOL_RETURN(true)
+}
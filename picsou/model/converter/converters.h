@@ -8,5 +8,7 @@ typedef bool (*db_converter_t)(QJsonDocument *doc, PicsouUIServicePtr ui_svc);
 
 bool convert_100_110(QJsonDocument *doc, PicsouUIServicePtr ui_svc);
 bool convert_110_200(QJsonDocument *doc, PicsouUIServicePtr ui_svc);
+bool convert_200_210(QJsonDocument *doc, PicsouUIServicePtr ui_svc);
+bool convert_210_220(QJsonDocument *doc, PicsouUIServicePtr ui_svc);
 
 #endif // CONVERTERS_H
@@ -0,0 +1,90 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "forecast.h"
+#include "utils/macro.h"
+
+#include <algorithm>
+
+const int Forecast::DEFAULT_HORIZON_YEARS=5;
+
+static bool not_below(qint64 minimum, qint64 limit)
+{
+    return minimum>=limit;
+}
+
+Forecast::Forecast()
+{
+
+}
+
+Forecast::Forecast(const AccountShPtrList &accounts, const QDate &horizon) :
+    m_start(QDate::currentDate()),
+    m_horizon(qMax(m_start, horizon))
+{
+    LOG_IN("accounts.size="<<accounts.size()<<",horizon="<<horizon)
+    int days=static_cast<int>(m_start.daysTo(m_horizon))+1;
+    QVector<qint64> deltas(days, 0);
+    QDate next=m_start.addDays(1);
+    for(const auto &account : accounts) {
+        /* starting balance is read from the running totals, only future changes are scanned */
+        deltas[0]+=account->balance(m_start).minor_units();
+        for(const auto &op : account->ops(next, m_horizon)) {
+            deltas[static_cast<int>(m_start.daysTo(op->date()))]+=op->amount().minor_units();
+        }
+        for(const auto &sop : account->scheduled_ops()) {
+            qint64 amount=sop->amount().minor_units();
+            for(const auto &date : sop->occurrences(next, m_horizon)) {
+                deltas[static_cast<int>(m_start.daysTo(date))]+=amount;
+            }
+        }
+    }
+    /* prefix sums answer balance queries, running minimums threshold queries */
+    m_balances.resize(days);
+    m_minimums.resize(days);
+    qint64 balance=0, minimum=0;
+    for(int day=0; day<days; ++day) {
+        balance+=deltas.at(day);
+        minimum=(day==0?balance:qMin(minimum, balance));
+        m_balances[day]=balance;
+        m_minimums[day]=minimum;
+    }
+    LOG_VOID_RETURN()
+}
+
+bool Forecast::balance(const QDate &date, Amount &balance) const
+{
+    if(!valid()||date<m_start||date>m_horizon) {
+        LOG_WARNING("date is out of the forecast range.")
+        return false;
+    }
+    balance=Amount::from_minor_units(m_balances.at(static_cast<int>(m_start.daysTo(date))));
+    return true;
+}
+
+QDate Forecast::first_below(const Amount &threshold) const
+{
+    /* running minimums never increase, the first one below threshold is found by bisection */
+    QVector<qint64>::const_iterator it=std::lower_bound(m_minimums.constBegin(),
+                                                        m_minimums.constEnd(),
+                                                        threshold.minor_units(),
+                                                        not_below);
+    if(it==m_minimums.constEnd()) {
+        return QDate();
+    }
+    return m_start.addDays(it-m_minimums.constBegin());
+}
@@ -0,0 +1,52 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include <QDate>
+#include <QVector>
+
+#include "utils/amount.h"
+#include "object/account.h"
+
+/* balance of a set of accounts projected day by day, from the current date
+   up to a horizon, using recorded operations and scheduled operations */
+class Forecast
+{
+public:
+    static const int DEFAULT_HORIZON_YEARS;
+
+    Forecast();
+    Forecast(const AccountShPtrList &accounts, const QDate &horizon);
+
+    inline QDate start() const { return m_start; }
+    inline QDate horizon() const { return m_horizon; }
+    inline bool valid() const { return !m_balances.isEmpty(); }
+
+    bool balance(const QDate &date, Amount &balance) const;
+    QDate first_below(const Amount &threshold) const;
+
+private:
+    QDate m_start;
+    QDate m_horizon;
+    /* end of day balances and their running minimum in minor units, indexed by days since start */
+    QVector<qint64> m_balances;
+    QVector<qint64> m_minimums;
+};
+
+#endif // FORECAST_H
@@ -0,0 +1,83 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <QHash>
+#include <QUuid>
+#include <QString>
+#include <QSharedPointer>
+
+/* maps the names of the objects of a scope to these objects, the index is
+   rebuilt from the scope on next lookup once it has been invalidated */
+template<typename T>
+class NameIndex
+{
+public:
+    typedef QSharedPointer<T> TShPtr;
+
+    NameIndex() :
+        m_stale(true)
+    {
+
+    }
+
+    inline void invalidate() { m_stale=true; }
+
+    void insert(const TShPtr &obj)
+    {
+        if(!m_stale) {
+            m_names.insert(obj->name(), obj);
+        }
+    }
+
+    void remove(const T *obj)
+    {
+        if(!m_stale&&m_names.value(obj->name()).data()==obj) {
+            m_names.remove(obj->name());
+        } else {
+            m_stale=true;
+        }
+    }
+
+    /* called when obj was modified, a renamed object is no longer indexed under its name */
+    void check(const T *obj)
+    {
+        if(!m_stale&&m_names.value(obj->name()).data()!=obj) {
+            m_stale=true;
+        }
+    }
+
+    TShPtr find(const QString &name, const QHash<QUuid, TShPtr> &objects) const
+    {
+        if(m_stale) {
+            m_names.clear();
+            for(const auto &obj : objects) {
+                m_names.insert(obj->name(), obj);
+            }
+            m_stale=false;
+        }
+        return m_names.value(name);
+    }
+
+private:
+    mutable bool m_stale;
+    mutable QHash<QString, TShPtr> m_names;
+};
+
+#endif // NAMEINDEX_H
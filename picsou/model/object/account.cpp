@@ -18,7 +18,6 @@
 #include "account.h"
 #include "utils/macro.h"
 
-#include <QSet>
 #include <QJsonArray>
 
 const QString Account::KW_OPS="ops";
@@ -28,13 +27,23 @@ const QString Account::KW_ARCHIVED="archived";
 const QString Account::KW_INITIAL_AMOUNT="init_amount";
 const QString Account::KW_PAYMENT_METHODS="payment_methods";
 const QString Account::KW_SCHEDULED_OPS="scheduled_ops";
+const QString Account::KW_PROPERTIES="properties";
+const QString Account::KW_REMOVED_OPS="removed_ops";
+const QString Account::KW_FIRST_YEAR="first_year";
 
 Account::Account(PicsouDBO *parent) :
     PicsouDBO(false, parent),
     m_name(QString()),
     m_notes(QString()),
     m_archived(false),
-    m_initial_amount(0.)
+    m_initial_amount(0.),
+    m_loaded(true),
+    m_date_indexed(false),
+    m_date_balances_valid(0),
+    m_text_indexed(false),
+    m_wseg(),
+    m_seg_first_year(INT_MAX),
+    m_props_dirty(false)
 {
 
 }
@@ -48,7 +57,14 @@ Account::Account(const QString &name,
     m_name(name),
     m_notes(notes),
     m_archived(archived),
-    m_initial_amount(intial_amount)
+    m_initial_amount(intial_amount),
+    m_loaded(true),
+    m_date_indexed(false),
+    m_date_balances_valid(0),
+    m_text_indexed(false),
+    m_wseg(),
+    m_seg_first_year(INT_MAX),
+    m_props_dirty(true)
 {
 
 }
@@ -78,6 +94,7 @@ bool Account::add_payment_method(const QString &name, QString &error)
     }
     PaymentMethodShPtr pm=PaymentMethodShPtr(new PaymentMethod(name, this));
     m_payment_methods.insert(pm->id(), pm);
+    m_payment_method_names.insert(pm);
     emit modified();
     return true;
 }
@@ -88,6 +105,10 @@ bool Account::remove_payment_method(QUuid id)
         return false;
     }
     bool success=false;
+    PaymentMethodShPtr pm=m_payment_methods.value(id);
+    if(!pm.isNull()) {
+        m_payment_method_names.remove(pm.data());
+    }
     switch (m_payment_methods.remove(id)) {
     case 0:
         /* TRACE */
@@ -142,6 +163,7 @@ bool Account::remove_scheduled_operation(QUuid id, QString &error)
         break;
     case 1:
         success=true;
+        m_occurrences.remove(id);
         emit modified();
         break;
     default:
@@ -164,6 +186,10 @@ bool Account::add_operation(bool verified,
         error=tr("Cannot modify an archived account.");
         return false;
     }
+    if(!load()) {
+        error=tr("Failed to decrypt account operations.");
+        return false;
+    }
     OperationShPtr op=OperationShPtr(new Operation(verified,
                                                    amount,
                                                    date,
@@ -173,7 +199,11 @@ bool Account::add_operation(bool verified,
                                                    payment_method,
                                                    this));
      m_ops.insert(op->id(), op);
-     emit modified();
+     m_dirty_ops.insert(op->id());
+     m_wseg.clear();
+     invalidate_collections(op.data());
+     index_insert(op);
+     PicsouDBO::track_modified(this);
      return true;
 }
 
@@ -183,13 +213,21 @@ bool Account::add_operations(const OperationShPtrList &ops, QString &error)
         error=tr("Cannot modify an archived account.");
         return false;
     }
+    if(!load()) {
+        error=tr("Failed to decrypt account operations.");
+        return false;
+    }
     bool success=false;
     for(const auto &op : ops) {
-        op->set_parent(this);
+        op->set_account(this);
         m_ops.insert(op->id(), op);
+        m_dirty_ops.insert(op->id());
+        invalidate_collections(op.data());
+        index_insert(op);
     }
     if(ops.length()>0) {
-        emit modified();
+        m_wseg.clear();
+        PicsouDBO::track_modified(this);
         success=true;
     }
     return success;
@@ -201,14 +239,26 @@ bool Account::remove_operation(QUuid id, QString &error)
         error=tr("Cannot modify an archived account.");
         return false;
     }
+    if(!load()) {
+        error=tr("Failed to decrypt account operations.");
+        return false;
+    }
     bool success=false;
+    OperationShPtr op=m_ops.value(id);
+    if(!op.isNull()) {
+        invalidate_collections(op.data());
+        index_remove(op.data());
+    }
     switch (m_ops.remove(id)) {
     case 0:
         error=tr("Failed to remove operation: not found.");
         break;
     case 1:
         success=true;
-        emit modified();
+        m_dirty_ops.remove(id);
+        m_removed_ops.insert(id);
+        m_wseg.clear();
+        PicsouDBO::track_modified(this);
         break;
     default:
         error=tr("Failed to remove operation: doublons deleted.");
@@ -229,12 +279,7 @@ PaymentMethodShPtr Account::find_payment_method(QUuid id)
 
 PaymentMethodShPtr Account::find_payment_method(const QString &name)
 {
-    for(const auto &pm : m_payment_methods) {
-        if(pm->name()==name) {
-            return pm;
-        }
-    }
-    return PaymentMethodShPtr();
+    return m_payment_method_names.find(name, m_payment_methods);
 }
 
 ScheduledOperationShPtr Account::find_scheduled_operation(QUuid id)
@@ -250,6 +295,7 @@ ScheduledOperationShPtr Account::find_scheduled_operation(QUuid id)
 OperationShPtr Account::find_operation(QUuid id)
 {
     OperationShPtr op;
+    load();
     QHash<QUuid, OperationShPtr>::const_iterator it=m_ops.find(id);
     if(it!=m_ops.end()) {
         op=*it;
@@ -259,12 +305,464 @@ OperationShPtr Account::find_operation(QUuid id)
 
 #define min(a, b) (((a)<(b))?(a):(b))
 
-int Account::min_year() const
+OperationShPtrList Account::ops() const
+{
+    load();
+    return m_ops.values();
+}
+
+static bool index_date_cmp(const QPair<QDate, OperationShPtr> &entry, const QDate &date)
+{
+    return entry.first<date;
+}
+
+static bool date_index_cmp(const QDate &date, const QPair<QDate, OperationShPtr> &entry)
+{
+    return date<entry.first;
+}
+
+OperationShPtrList Account::ops(const QDate &from, const QDate &to) const
+{
+    load();
+    ensure_indexed();
+    /* invalid bounds leave the range open */
+    QVector<DateIndexEntry>::const_iterator first=m_date_index.constBegin(),
+                                            last=m_date_index.constEnd();
+    if(from.isValid()) {
+        first=std::lower_bound(first, last, from, index_date_cmp);
+    }
+    if(to.isValid()) {
+        last=std::upper_bound(first, last, to, date_index_cmp);
+    }
+    OperationShPtrList ops;
+    ops.reserve(static_cast<int>(last-first));
+    for(; first!=last; ++first) {
+        ops.append(first->second);
+    }
+    return ops;
+}
+
+static bool index_amount_cmp(const QPair<qint64, OperationShPtr> &entry, qint64 amount)
+{
+    return entry.first<amount;
+}
+
+static bool amount_index_cmp(qint64 amount, const QPair<qint64, OperationShPtr> &entry)
+{
+    return amount<entry.first;
+}
+
+static qint64 index_amount(const Operation *op)
+{
+    /* queries bound the absolute value of amounts */
+    return qAbs(op->amount().minor_units());
+}
+
+bool Account::text_candidates(const QString &filter, OperationShPtrList &ops) const
+{
+    load();
+    ensure_text_indexed();
+    QSet<QUuid> ids;
+    if(!m_text_index.candidates(filter, ids)) {
+        return false;
+    }
+    ops.clear();
+    ops.reserve(ids.size());
+    for(const auto &id : ids) {
+        OperationShPtr op=m_ops.value(id);
+        if(!op.isNull()) {
+            ops.append(op);
+        }
+    }
+    return true;
+}
+
+OperationShPtrList Account::search_candidates(const SearchQuery &query) const
+{
+    load();
+    ensure_indexed();
+    /* both ranges are bounded in logarithmic time, the narrowest one is scanned
+       and the query checks the remaining clauses on it */
+    QVector<DateIndexEntry>::const_iterator date_first=m_date_index.constBegin(),
+                                            date_last=m_date_index.constEnd();
+    if(query.from().isValid()) {
+        date_first=std::lower_bound(date_first, date_last, query.from(), index_date_cmp);
+    }
+    if(query.to().isValid()) {
+        date_last=std::upper_bound(date_first, date_last, query.to(), date_index_cmp);
+    }
+    QVector<AmountIndexEntry>::const_iterator amount_first=std::lower_bound(m_amount_index.constBegin(),
+                                                                            m_amount_index.constEnd(),
+                                                                            query.min().minor_units(),
+                                                                            index_amount_cmp),
+                                              amount_last=std::upper_bound(amount_first,
+                                                                           m_amount_index.constEnd(),
+                                                                           query.max().minor_units(),
+                                                                           amount_index_cmp);
+    int date_count=static_cast<int>(date_last-date_first),
+        amount_count=static_cast<int>(amount_last-amount_first);
+    OperationShPtrList ops;
+    if(!query.description_filter().isEmpty()) {
+        /* resolving a filter bisects the text index, building it scans
+           every operation */
+        int text_cost=(m_text_indexed?0:m_ops.size());
+        if(text_cost<qMin(date_count, amount_count)
+                &&text_candidates(query.description_filter(), ops)
+                &&ops.length()<qMin(date_count, amount_count)) {
+            return ops;
+        }
+        ops.clear();
+    }
+    if(date_count<=amount_count) {
+        ops.reserve(date_count);
+        for(; date_first!=date_last; ++date_first) {
+            ops.append(date_first->second);
+        }
+    } else {
+        ops.reserve(amount_count);
+        for(; amount_first!=amount_last; ++amount_first) {
+            ops.append(amount_first->second);
+        }
+    }
+    return ops;
+}
+
+void Account::index_insert(const OperationShPtr &op) const
+{
+    if(m_text_indexed) {
+        m_text_index.insert(op.data());
+    }
+    if(!m_date_indexed) {
+        return;
+    }
+    QVector<DateIndexEntry>::iterator it=std::upper_bound(m_date_index.begin(),
+                                                          m_date_index.end(),
+                                                          op->date(),
+                                                          date_index_cmp);
+    int pos=static_cast<int>(it-m_date_index.begin());
+    m_date_index.insert(it, DateIndexEntry(op->date(), op));
+    m_indexed_dates.insert(op->id(), op->date());
+    /* running totals after the inserted operation are recomputed on demand */
+    m_date_balances.insert(pos, 0);
+    m_date_balances_valid=qMin(m_date_balances_valid, pos);
+    qint64 amount=index_amount(op.data());
+    QVector<AmountIndexEntry>::iterator amount_it=std::upper_bound(m_amount_index.begin(),
+                                                                   m_amount_index.end(),
+                                                                   amount,
+                                                                   amount_index_cmp);
+    m_amount_index.insert(amount_it, AmountIndexEntry(amount, op));
+    m_indexed_amounts.insert(op->id(), amount);
+    m_rollup.insert(op.data());
+}
+
+void Account::index_remove(const Operation *op) const
+{
+    if(m_text_indexed) {
+        m_text_index.remove(op);
+    }
+    if(!m_date_indexed) {
+        return;
+    }
+    m_rollup.remove(op);
+    QHash<QUuid, QDate>::iterator date_it=m_indexed_dates.find(op->id());
+    if(date_it==m_indexed_dates.end()) {
+        return;
+    }
+    QVector<DateIndexEntry>::iterator it=std::lower_bound(m_date_index.begin(),
+                                                          m_date_index.end(),
+                                                          *date_it,
+                                                          index_date_cmp);
+    for(; it!=m_date_index.end()&&it->first==*date_it; ++it) {
+        if(it->second.data()==op) {
+            int pos=static_cast<int>(it-m_date_index.begin());
+            m_date_index.erase(it);
+            m_date_balances.remove(pos);
+            m_date_balances_valid=qMin(m_date_balances_valid, pos);
+            break;
+        }
+    }
+    m_indexed_dates.erase(date_it);
+    QHash<QUuid, qint64>::iterator amount_it=m_indexed_amounts.find(op->id());
+    if(amount_it==m_indexed_amounts.end()) {
+        return;
+    }
+    QVector<AmountIndexEntry>::iterator entry=std::lower_bound(m_amount_index.begin(),
+                                                               m_amount_index.end(),
+                                                               *amount_it,
+                                                               index_amount_cmp);
+    for(; entry!=m_amount_index.end()&&entry->first==*amount_it; ++entry) {
+        if(entry->second.data()==op) {
+            m_amount_index.erase(entry);
+            break;
+        }
+    }
+    m_indexed_amounts.erase(amount_it);
+}
+
+void Account::index_invalidate() const
+{
+    m_text_indexed=false;
+    m_text_index.clear();
+    m_date_indexed=false;
+    m_date_index.clear();
+    m_indexed_dates.clear();
+    m_date_balances.clear();
+    m_date_balances_valid=0;
+    m_amount_index.clear();
+    m_indexed_amounts.clear();
+    m_rollup.clear();
+}
+
+static bool op_index_cmp(const QPair<QDate, OperationShPtr> &a, const QPair<QDate, OperationShPtr> &b)
+{
+    return a.first<b.first;
+}
+
+static bool op_amount_cmp(const QPair<qint64, OperationShPtr> &a, const QPair<qint64, OperationShPtr> &b)
+{
+    return a.first<b.first;
+}
+
+void Account::ensure_indexed() const
+{
+    if(m_date_indexed) {
+        return;
+    }
+    m_date_index.clear();
+    m_date_index.reserve(m_ops.size());
+    m_indexed_dates.clear();
+    m_indexed_dates.reserve(m_ops.size());
+    m_rollup.clear();
+    m_amount_index.clear();
+    m_amount_index.reserve(m_ops.size());
+    m_indexed_amounts.clear();
+    m_indexed_amounts.reserve(m_ops.size());
+    for(const auto &op : m_ops) {
+        m_date_index.append(DateIndexEntry(op->date(), op));
+        m_indexed_dates.insert(op->id(), op->date());
+        qint64 amount=index_amount(op.data());
+        m_amount_index.append(AmountIndexEntry(amount, op));
+        m_indexed_amounts.insert(op->id(), amount);
+        m_rollup.insert(op.data());
+    }
+    std::stable_sort(m_date_index.begin(), m_date_index.end(), op_index_cmp);
+    std::stable_sort(m_amount_index.begin(), m_amount_index.end(), op_amount_cmp);
+    m_date_balances.fill(0, m_date_index.size());
+    m_date_balances_valid=0;
+    m_date_indexed=true;
+}
+
+void Account::ensure_text_indexed() const
 {
-    int min_y=INT_MAX;
+    if(m_text_indexed) {
+        return;
+    }
+    m_text_index.clear();
     for(const auto &op : m_ops) {
-        min_y=min(min_y, op->date().year());
+        m_text_index.insert(op.data());
+    }
+    m_text_indexed=true;
+}
+
+qint64 Account::recorded_balance(int count) const
+{
+    /* running totals are only recomputed from the first edited position */
+    for(; m_date_balances_valid<count; ++m_date_balances_valid) {
+        int i=m_date_balances_valid;
+        m_date_balances[i]=(i>0?m_date_balances.at(i-1):0)+m_date_index.at(i).second->amount().minor_units();
+    }
+    return (count>0?m_date_balances.at(count-1):0);
+}
+
+static bool balance_entry_cmp(const QPair<QDate, qint64> &a, const QPair<QDate, qint64> &b)
+{
+    return a.first<b.first;
+}
+
+static bool date_balance_cmp(const QDate &date, const QPair<QDate, qint64> &entry)
+{
+    return date<entry.first;
+}
+
+void Account::ensure_occurrence_balances() const
+{
+    /* endless schedules generate operations until current date */
+    if(m_occurrence_balances_day==QDate::currentDate()) {
+        return;
+    }
+    m_occurrence_balances.clear();
+    m_occurrence_rollup.clear();
+    for(const auto &sop : m_scheduled_ops) {
+        qint64 amount=sop->amount().minor_units();
+        for(const auto &date : sop->occurrences()) {
+            m_occurrence_balances.append(BalanceEntry(date, amount));
+            m_occurrence_rollup.add(sop->prototype(), date);
+        }
+    }
+    std::stable_sort(m_occurrence_balances.begin(), m_occurrence_balances.end(), balance_entry_cmp);
+    for(int i=1; i<m_occurrence_balances.size(); ++i) {
+        m_occurrence_balances[i].second+=m_occurrence_balances.at(i-1).second;
+    }
+    m_occurrence_balances_day=QDate::currentDate();
+}
+
+Amount Account::balance(const QDate &date) const
+{
+    load();
+    ensure_indexed();
+    ensure_occurrence_balances();
+    QVector<DateIndexEntry>::const_iterator last=std::upper_bound(m_date_index.constBegin(),
+                                                                  m_date_index.constEnd(),
+                                                                  date,
+                                                                  date_index_cmp);
+    qint64 balance=m_initial_amount.minor_units()+recorded_balance(static_cast<int>(last-m_date_index.constBegin()));
+    QVector<BalanceEntry>::const_iterator occurrence=std::upper_bound(m_occurrence_balances.constBegin(),
+                                                                      m_occurrence_balances.constEnd(),
+                                                                      date,
+                                                                      date_balance_cmp);
+    if(occurrence!=m_occurrence_balances.constBegin()) {
+        balance+=(occurrence-1)->second;
+    }
+    return Amount::from_minor_units(balance);
+}
+
+typedef QPair<QDate, ScheduledOperationShPtr> GeneratedEntry;
+
+static bool generated_cmp(const GeneratedEntry &a, const GeneratedEntry &b)
+{
+    return a.first<b.first;
+}
+
+void Account::check_current_day()
+{
+    if(m_collections_day==QDate::currentDate()) {
+        return;
+    }
+    /* endless schedules generate operations until current date */
+    for(const auto &sop : m_scheduled_ops) {
+        if(sop->schedule().endless()) {
+            m_occurrences.remove(sop->id());
+        }
+    }
+    invalidate_collections();
+    m_collections_day=QDate::currentDate();
+}
+
+QVector<QDate> Account::occurrences(const ScheduledOperationShPtr &sop, int year, int month)
+{
+    check_current_day();
+    QVector<QDate> dates;
+    Schedule schedule=sop->schedule();
+    if(!schedule.from().isValid()) {
+        return dates;
+    }
+    int first, last;
+    if(year!=-1) {
+        first=Rollup::month_key(year, (month==-1?1:month));
+        last=Rollup::month_key(year, (month==-1?12:month));
+    } else {
+        QDate until=(schedule.endless()?QDate::currentDate():schedule.until());
+        QDate end=qMax(schedule.from(), until);
+        first=Rollup::month_key(schedule.from().year(), schedule.from().month());
+        last=Rollup::month_key(end.year(), end.month());
+    }
+    OccurrenceBuckets &buckets=m_occurrences[sop->id()];
+    for(int key=first; key<=last; ++key) {
+        if(month!=-1&&key%12!=month-1) {
+            continue;
+        }
+        OccurrenceBuckets::const_iterator it=buckets.constFind(key);
+        if(it==buckets.constEnd()) {
+            QVector<QDate> bucket;
+            for(const auto &date : sop->occurrences(key/12, key%12+1)) {
+                bucket.append(date);
+            }
+            it=buckets.insert(key, bucket);
+        }
+        dates+=*it;
     }
+    return dates;
+}
+
+OperationCollection Account::collection(int year, int month)
+{
+    check_current_day();
+    CollectionKey key(year, month);
+    QHash<CollectionKey, OperationCollection>::const_iterator it=m_collections.find(key);
+    if(it!=m_collections.end()) {
+        return *it;
+    }
+    LOG_DEBUG("building collection for year="<<year<<",month="<<month)
+    QVector<GeneratedEntry> generated;
+    for(const auto &sop : m_scheduled_ops) {
+        for(const auto &date : occurrences(sop, year, month)) {
+            generated.append(GeneratedEntry(date, sop));
+        }
+    }
+    std::stable_sort(generated.begin(), generated.end(), generated_cmp);
+    QDate from, to;
+    if(year!=-1) {
+        from=QDate(year, (month==-1?1:month), 1);
+        to=(month==-1?QDate(year, 12, 31):from.addMonths(1).addDays(-1));
+    }
+    OperationCollection collection(m_initial_amount);
+    for(const auto &op : ops(from, to)) {
+        /* same month of every year, rare enough to filter */
+        if(year==-1&&month!=-1&&op->date().month()!=month) {
+            continue;
+        }
+        collection.store(op);
+    }
+    /* both sequences are ordered, views and lists merge them */
+    for(const auto &entry : generated) {
+        collection.store(entry.second, entry.first);
+    }
+    /* totals are read from the rollups rather than from every operation */
+    ensure_occurrence_balances();
+    collection.aggregate(m_rollup, from, to, month);
+    collection.aggregate(m_occurrence_rollup, from, to, month);
+    m_collections.insert(key, collection);
+    return collection;
+}
+
+void Account::invalidate_collections()
+{
+    m_collections.clear();
+    /* scheduled operations or current day changed */
+    m_occurrence_balances_day=QDate();
+}
+
+void Account::invalidate_collections(const QDate &date)
+{
+    if(!date.isValid()) {
+        return;
+    }
+    m_collections.remove(CollectionKey(date.year(), date.month()));
+    m_collections.remove(CollectionKey(date.year(), -1));
+    m_collections.remove(CollectionKey(-1, date.month()));
+    m_collections.remove(CollectionKey(-1, -1));
+}
+
+void Account::invalidate_collections(const Operation *op)
+{
+    /* operation may have moved from the month it was indexed in */
+    invalidate_collections(m_indexed_dates.value(op->id()));
+    invalidate_collections(op->date());
+}
+
+int Account::ops_min_year() const
+{
+    if(!m_loaded) {
+        /* avoid decrypting operations only to build the tree */
+        return m_seg_first_year;
+    }
+    ensure_indexed();
+    return (m_date_index.isEmpty()?INT_MAX:m_date_index.first().first.year());
+}
+
+int Account::min_year() const
+{
+    int min_y=ops_min_year();
     for(const auto &sop : m_scheduled_ops) {
         min_y=min(min_y, sop->schedule().from().year());
     }
@@ -275,6 +773,7 @@ int Account::min_year() const
 QStringList Account::srcdst() const
 {
     QSet<QString> srcdst;
+    load();
     for(const auto &op : m_ops) {
         srcdst.insert(op->srcdst());
     }
@@ -311,13 +810,179 @@ QStringList Account::payment_methods_str(bool sorted) const
 }
 
 bool Account::read(const QJsonObject &json)
+{
+    LOG_IN("<QJsonObject>")
+    static const QStringList keys=(QStringList()<<KW_OPS);
+    JSON_CHECK_KEYS(keys);
+    if(!read_properties(json)) {
+        LOG_BOOL_RETURN(false)
+    }
+    JSON_READ_LIST(json, KW_OPS,
+                   m_ops, Operation, this);
+    /**/
+    set_valid();
+    LOG_BOOL_RETURN(valid())
+}
+
+bool Account::read(const QJsonObject &json, const ColumnarDocument::Block &block)
+{
+    LOG_IN("<QJsonObject>,block.count="<<block.count())
+    if(!read_properties(json)) {
+        LOG_BOOL_RETURN(false)
+    }
+    read_block(block);
+    /**/
+    set_valid();
+    LOG_BOOL_RETURN(valid())
+}
+
+bool Account::read_segmented(const QJsonObject &json, const QString &wseg)
+{
+    LOG_IN("<QJsonObject>,wseg")
+    if(!read_properties(json)) {
+        LOG_BOOL_RETURN(false)
+    }
+    m_wseg=wseg;
+    /* an empty segment marks an account without operations */
+    m_loaded=wseg.isEmpty();
+    m_seg_first_year=json[KW_FIRST_YEAR].toInt(INT_MAX);
+    /**/
+    set_valid();
+    LOG_BOOL_RETURN(valid())
+}
+
+void Account::read_block(const ColumnarDocument::Block &block) const
+{
+    Account *self=const_cast<Account*>(this);
+    m_ops.reserve(m_ops.size()+block.count());
+    for(int row=0; row<block.count(); ++row) {
+        /* record and reference count share a single allocation */
+        OperationShPtr op=OperationShPtr::create(block.verified(row),
+                                                 block.amount(row),
+                                                 block.date(row),
+                                                 block.budget(row),
+                                                 block.srcdst(row),
+                                                 block.description(row),
+                                                 block.payment_method(row),
+                                                 self);
+        if(block.has_ids()) {
+            op->set_id(block.id(row));
+        }
+        m_ops.insert(op->id(), op);
+    }
+}
+
+bool Account::load() const
+{
+    if(m_loaded) {
+        return true;
+    }
+    if(!valid()) {
+        /* segment already failed to load, do not decrypt it again */
+        return false;
+    }
+    LOG_IN_VOID()
+    LOG_BOOL_RETURN(read_segment(decrypt_segment(m_wseg)))
+}
+
+bool Account::load(const QString &wseg, const ColumnarDocument &doc)
+{
+    LOG_IN("wseg,<ColumnarDocument>")
+    if(m_loaded||wseg!=m_wseg) {
+        /* loaded on access while the segment was being decrypted */
+        LOG_BOOL_RETURN(true)
+    }
+    if(!valid()) {
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_BOOL_RETURN(read_segment(doc))
+}
+
+ColumnarDocument Account::decrypt_segment(const QString &wseg) const
+{
+    LOG_IN("wseg")
+    /* only reads the key of the parent user, this may run on any thread */
+    QByteArray data;
+    if(!unwrap_data(wseg, data)) {
+        LOG_CRITICAL("failed to unwrap account segment.")
+        return ColumnarDocument();
+    }
+    return ColumnarDocument(data);
+}
+
+bool Account::read_segment(const ColumnarDocument &doc) const
+{
+    LOG_IN("<ColumnarDocument>")
+    if(!doc.valid()||doc.block_count()!=1) {
+        LOG_CRITICAL("invalid account segment.")
+        /* wrapped segment is kept as is and written back on save */
+        const_cast<Account*>(this)->set_valid(false);
+        LOG_BOOL_RETURN(false)
+    }
+    read_block(doc.block(0));
+    index_invalidate();
+    m_loaded=true;
+    LOG_BOOL_RETURN(true)
+}
+
+bool Account::write(QJsonObject &json) const
+{
+    LOG_IN("<QJsonObject>")
+    if(!load()) {
+        LOG_BOOL_RETURN(false)
+    }
+    if(!write_properties(json)) {
+        LOG_BOOL_RETURN(false)
+    }
+    JSON_WRITE_LIST(json, KW_OPS, m_ops.values());
+    /**/
+    LOG_BOOL_RETURN(true)
+}
+
+bool Account::write_properties(QJsonObject &json) const
+{
+    LOG_IN("<QJsonObject>")
+    json[KW_NAME]=m_name;
+    json[KW_NOTES]=m_notes;
+    json[KW_ARCHIVED]=m_archived;
+    json[KW_INITIAL_AMOUNT]=m_initial_amount.value();
+    json[KW_FIRST_YEAR]=ops_min_year();
+    JSON_WRITE_LIST(json, KW_PAYMENT_METHODS, m_payment_methods.values());
+    JSON_WRITE_LIST(json, KW_SCHEDULED_OPS, m_scheduled_ops.values());
+    /**/
+    LOG_BOOL_RETURN(true)
+}
+
+bool Account::snapshot_segment(QString &wseg, Deferred &deferred) const
+{
+    LOG_IN("wseg,<Deferred>")
+    if(!m_wseg.isEmpty()) {
+        /* operations did not change since segment was last wrapped */
+        wseg=m_wseg;
+        LOG_BOOL_RETURN(true)
+    }
+    if(m_ops.isEmpty()) {
+        /* explicit marker of an account without operations */
+        wseg=QString("");
+        LOG_BOOL_RETURN(true)
+    }
+    QList<OperationShPtrList> blocks;
+    blocks.append(m_ops.values());
+    if(!defer_data(ColumnarDocument::encode(QJsonObject(), blocks), deferred)) {
+        LOG_CRITICAL("failed to snapshot account segment.")
+        LOG_BOOL_RETURN(false)
+    }
+    wseg=QString();
+    LOG_BOOL_RETURN(true)
+}
+
+bool Account::read_properties(const QJsonObject &json)
 {
     LOG_IN("<QJsonObject>")
     static const QStringList keys=(QStringList()<<KW_NAME
                                                 <<KW_NOTES
                                                 <<KW_PAYMENT_METHODS
-                                                <<KW_SCHEDULED_OPS
-                                                <<KW_OPS);
+                                                <<KW_SCHEDULED_OPS);
     JSON_CHECK_KEYS(keys);
     /**/
     m_name=json[KW_NAME].toString();
@@ -328,31 +993,154 @@ bool Account::read(const QJsonObject &json)
     if(json.contains(KW_INITIAL_AMOUNT)) {
         m_initial_amount=json[KW_INITIAL_AMOUNT].toDouble();
     }
+    m_payment_method_names.invalidate();
+    m_occurrences.clear();
+    m_occurrence_balances_day=QDate();
     JSON_READ_LIST(json, KW_PAYMENT_METHODS,
                    m_payment_methods, PaymentMethod, this);
     JSON_READ_LIST(json, KW_SCHEDULED_OPS,
                    m_scheduled_ops, ScheduledOperation, this);
-    JSON_READ_LIST(json, KW_OPS,
-                   m_ops, Operation, this);
-    /**/
-    set_valid();
-    LOG_BOOL_RETURN(valid())
+    LOG_BOOL_RETURN(true)
 }
 
-bool Account::write(QJsonObject &json) const
+bool Account::write_journal(QJsonObject &json) const
 {
     LOG_IN("<QJsonObject>")
-    json[KW_NAME]=m_name;
-    json[KW_NOTES]=m_notes;
-    json[KW_ARCHIVED]=m_archived;
-    json[KW_INITIAL_AMOUNT]=m_initial_amount.value();
-    JSON_WRITE_LIST(json, KW_PAYMENT_METHODS, m_payment_methods.values());
-    JSON_WRITE_LIST(json, KW_SCHEDULED_OPS, m_scheduled_ops.values());
-    JSON_WRITE_LIST(json, KW_OPS, m_ops.values());
-    /**/
+    QJsonObject op_json;
+    QJsonArray op_ary, removed_ary;
+    json[KW_ID]=id().toString();
+    if(m_props_dirty) {
+        QJsonObject props;
+        if(!write_properties(props)) {
+            LOG_BOOL_RETURN(false)
+        }
+        json[KW_PROPERTIES]=props;
+    }
+    for(const auto &op_id : m_dirty_ops) {
+        QHash<QUuid, OperationShPtr>::const_iterator it=m_ops.find(op_id);
+        if(it==m_ops.end()) {
+            continue;
+        }
+        op_json=QJsonObject();
+        if(!(*it)->write(op_json)) {
+            LOG_BOOL_RETURN(false)
+        }
+        op_json[KW_ID]=op_id.toString();
+        op_ary.append(op_json);
+    }
+    for(const auto &op_id : m_removed_ops) {
+        removed_ary.append(op_id.toString());
+    }
+    json[KW_OPS]=op_ary;
+    json[KW_REMOVED_OPS]=removed_ary;
     LOG_BOOL_RETURN(true)
 }
 
+bool Account::replay_journal(const QJsonObject &json)
+{
+    LOG_IN("<QJsonObject>")
+    if(json.contains(KW_PROPERTIES)) {
+        m_payment_methods.clear();
+        m_scheduled_ops.clear();
+        if(!read_properties(json[KW_PROPERTIES].toObject())) {
+            LOG_BOOL_RETURN(false)
+        }
+    }
+    QJsonArray removed_ary=json[KW_REMOVED_OPS].toArray();
+    QJsonArray op_ary=json[KW_OPS].toArray();
+    if(!removed_ary.isEmpty()||!op_ary.isEmpty()) {
+        if(!load()) {
+            LOG_BOOL_RETURN(false)
+        }
+        m_wseg.clear();
+    }
+    if(!removed_ary.isEmpty()||!op_ary.isEmpty()||json.contains(KW_PROPERTIES)) {
+        invalidate_collections();
+        index_invalidate();
+    }
+    for(const auto op_id : removed_ary) {
+        m_ops.remove(QUuid(op_id.toString()));
+    }
+    for(const auto op_ref : op_ary) {
+        QJsonObject op_json=op_ref.toObject();
+        QUuid op_id(op_json[KW_ID].toString());
+        OperationShPtr op=find_operation(op_id);
+        if(op.isNull()) {
+            op=OperationShPtr(new Operation(this));
+            op->set_id(op_id);
+            m_ops.insert(op_id, op);
+        }
+        if(!op->read(op_json)) {
+            LOG_BOOL_RETURN(false)
+        }
+    }
+    set_valid();
+    LOG_BOOL_RETURN(true)
+}
+
+void Account::mark_saved()
+{
+    m_props_dirty=false;
+    m_dirty_ops.clear();
+    m_removed_ops.clear();
+}
+
+void Account::track_modified(PicsouDBO *dbo)
+{
+    if(dbo==this||qobject_cast<ScheduledOperation*>(dbo)!=nullptr) {
+        /* initial amount or generated operations may have changed */
+        m_props_dirty=true;
+        m_occurrences.remove(dbo->id());
+        invalidate_collections();
+    } else if(qobject_cast<PaymentMethod*>(dbo)!=nullptr) {
+        m_props_dirty=true;
+        m_payment_method_names.check(static_cast<PaymentMethod*>(dbo));
+    }
+    PicsouDBO::track_modified(dbo);
+}
+
+void Account::operation_modified(Operation *op, const QDate &prev_date)
+{
+    OperationShPtr owned=m_ops.value(op->id());
+    if(owned.data()!=op) {
+        /* generated by a schedule, nothing to save */
+        return;
+    }
+    m_dirty_ops.insert(op->id());
+    m_wseg.clear();
+    invalidate_collections(prev_date);
+    invalidate_collections(op->date());
+    if(prev_date!=op->date()||
+            (m_date_indexed&&m_indexed_amounts.value(op->id())!=index_amount(op))) {
+        /* moved operation is re-inserted at its new date and amount */
+        index_remove(op);
+        index_insert(owned);
+    } else {
+        /* description, budget or payment method may have changed */
+        if(m_text_indexed) {
+            m_text_index.remove(op);
+            m_text_index.insert(op);
+        }
+        if(m_date_indexed) {
+            m_rollup.insert(op);
+            /* the amount may have changed sign only, the index keeps absolute
+               values: running totals are recomputed from the operation */
+            QVector<DateIndexEntry>::const_iterator it=std::lower_bound(m_date_index.constBegin(),
+                                                                        m_date_index.constEnd(),
+                                                                        op->date(),
+                                                                        index_date_cmp);
+            for(; it!=m_date_index.constEnd()&&it->first==op->date(); ++it) {
+                if(it->second.data()==op) {
+                    m_date_balances_valid=qMin(m_date_balances_valid,
+                                               static_cast<int>(it-m_date_index.constBegin()));
+                    break;
+                }
+            }
+        }
+    }
+    PicsouDBO::track_modified(this);
+}
+
 bool Account::operator <(const Account &other)
 {
     return (m_name<other.m_name);
@@ -20,8 +20,16 @@
 
 #include "paymentmethod.h"
 #include "scheduledoperation.h"
-
+#include "model/nameindex.h"
+#include "model/textindex.h"
+#include "model/searchquery.h"
+#include "model/rollup.h"
+#include "model/columnardocument.h"
+#include "model/operationcollection.h"
+
+#include <QSet>
 #include <QHash>
+#include <QVector>
 
 
 class Account : public PicsouDBO
@@ -35,6 +43,9 @@ public:
     static const QString KW_INITIAL_AMOUNT;
     static const QString KW_PAYMENT_METHODS;
     static const QString KW_SCHEDULED_OPS;
+    static const QString KW_PROPERTIES;
+    static const QString KW_REMOVED_OPS;
+    static const QString KW_FIRST_YEAR;
 
     Account(PicsouDBO *parent);
     Account(const QString &name,
@@ -83,7 +94,13 @@ public:
     inline QString notes() const { return m_notes; }
     inline Amount initial_amount() const { return m_initial_amount; }
     inline ScheduledOperationShPtrList scheduled_ops() const { return m_scheduled_ops.values(); }
-    inline OperationShPtrList ops() const { return m_ops.values(); }
+    OperationShPtrList ops() const;
+    OperationShPtrList ops(const QDate &from, const QDate &to) const;
+    bool text_candidates(const QString &filter, OperationShPtrList &ops) const;
+    OperationShPtrList search_candidates(const SearchQuery &query) const;
+    OperationCollection collection(int year=-1, int month=-1);
+    Amount balance(const QDate &date) const;
+    QVector<QDate> occurrences(const ScheduledOperationShPtr &sop, int year=-1, int month=-1);
 
     int min_year() const;
     QStringList srcdst() const;
@@ -91,18 +108,94 @@ public:
     PaymentMethodShPtrList payment_methods(bool sorted=false) const;
 
     bool read(const QJsonObject &json);
+    bool read(const QJsonObject &json, const ColumnarDocument::Block &block);
+    bool read_segmented(const QJsonObject &json, const QString &wseg);
     bool write(QJsonObject &json) const;
+    bool write_properties(QJsonObject &json) const;
+    /* segment is either already wrapped in wseg or left to deferred */
+    bool snapshot_segment(QString &wseg, Deferred &deferred) const;
+
+    inline bool loaded() const { return m_loaded; }
+    inline QString segment() const { return (m_loaded?QString():m_wseg); }
+    bool load() const;
+    bool load(const QString &wseg, const ColumnarDocument &doc);
+    ColumnarDocument decrypt_segment(const QString &wseg) const;
+
+    inline bool journal_dirty() const { return m_props_dirty||!m_dirty_ops.isEmpty()||!m_removed_ops.isEmpty(); }
+    bool write_journal(QJsonObject &json) const;
+    bool replay_journal(const QJsonObject &json);
+    void mark_saved();
 
     bool operator <(const Account &other);
 
+    void operation_modified(Operation *op, const QDate &prev_date);
+
+protected:
+    void track_modified(PicsouDBO *dbo);
+
+private:
+    bool read_properties(const QJsonObject &json);
+    void read_block(const ColumnarDocument::Block &block) const;
+    bool read_segment(const ColumnarDocument &doc) const;
+    int ops_min_year() const;
+    void index_insert(const OperationShPtr &op) const;
+    void index_remove(const Operation *op) const;
+    void index_invalidate() const;
+    void ensure_indexed() const;
+    void ensure_text_indexed() const;
+    qint64 recorded_balance(int count) const;
+    void ensure_occurrence_balances() const;
+    void check_current_day();
+    void invalidate_collections();
+    void invalidate_collections(const QDate &date);
+    void invalidate_collections(const Operation *op);
+
 private:
     QString m_name;
     QString m_notes;
     bool m_archived;
     Amount m_initial_amount;
     QHash<QUuid, PaymentMethodShPtr> m_payment_methods;
+    NameIndex<PaymentMethod> m_payment_method_names;
     QHash<QUuid, ScheduledOperationShPtr> m_scheduled_ops;
-    QHash<QUuid, OperationShPtr> m_ops;
+    /* operations are decrypted from m_wseg on first access */
+    mutable QHash<QUuid, OperationShPtr> m_ops;
+    mutable bool m_loaded;
+    /* operations ordered by date, built on first range query */
+    typedef QPair<QDate, OperationShPtr> DateIndexEntry;
+    mutable QVector<DateIndexEntry> m_date_index;
+    mutable QHash<QUuid, QDate> m_indexed_dates;
+    /* operations ordered by absolute amount in minor units, built with the date index */
+    typedef QPair<qint64, OperationShPtr> AmountIndexEntry;
+    mutable QVector<AmountIndexEntry> m_amount_index;
+    mutable QHash<QUuid, qint64> m_indexed_amounts;
+    mutable bool m_date_indexed;
+    /* running totals of the date index in minor units, valid up to m_date_balances_valid */
+    mutable QVector<qint64> m_date_balances;
+    mutable int m_date_balances_valid;
+    /* running totals and rollup of scheduled occurrences until current date, rebuilt on schedule changes */
+    typedef QPair<QDate, qint64> BalanceEntry;
+    mutable QVector<BalanceEntry> m_occurrence_balances;
+    mutable Rollup m_occurrence_rollup;
+    mutable QDate m_occurrence_balances_day;
+    /* totals per month, budget and payment method, built with the date index */
+    mutable Rollup m_rollup;
+    /* words of descriptions, built on first text search */
+    mutable TextIndex m_text_index;
+    mutable bool m_text_indexed;
+    mutable QString m_wseg;
+    int m_seg_first_year;
+    /* changes since last save */
+    bool m_props_dirty;
+    QSet<QUuid> m_dirty_ops;
+    QSet<QUuid> m_removed_ops;
+    /* collections per (year, month), -1 meaning any */
+    typedef QPair<int, int> CollectionKey;
+    QHash<CollectionKey, OperationCollection> m_collections;
+    QDate m_collections_day;
+    /* occurrences of each scheduled operation, bucketed by month */
+    typedef QHash<int, QVector<QDate> > OccurrenceBuckets;
+    QHash<QUuid, OccurrenceBuckets> m_occurrences;
 };
 
 DECL_PICSOU_OBJ_PTR(Account, AccountShPtr, AccountShPtrList);
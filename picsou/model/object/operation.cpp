@@ -16,6 +16,7 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "operation.h"
+#include "account.h"
 #include "paymentmethod.h"
 #include "utils/macro.h"
 
@@ -29,9 +30,23 @@ const QString Operation::KW_RECIPIENT="recipient";
 const QString Operation::KW_DESCRIPTION="description";
 const QString Operation::KW_PAYMENT_METHOD="paymentMethod";
 
-Operation::Operation(PicsouDBO *parent) :
-    PicsouDBO(false, parent),
-    m_verified(false)
+SymbolTable Operation::BUDGETS;
+SymbolTable Operation::PAYMENT_METHODS;
+
+void Operation::clear_symbols()
+{
+    BUDGETS.clear();
+    PAYMENT_METHODS.clear();
+}
+
+Operation::Operation(Account *account) :
+    m_id(QUuid::createUuid()),
+    m_account(account),
+    m_budget(0),
+    m_payment_method(0),
+    m_valid(false),
+    m_verified(false),
+    m_scheduled(false)
 {
 
 }
@@ -43,15 +58,34 @@ Operation::Operation(bool verified,
                      const QString &srcdst,
                      const QString &description,
                      const QString &payment_method,
-                     PicsouDBO *parent) :
-    PicsouDBO(true, parent),
-    m_verified(verified),
+                     Account *account) :
+    m_id(QUuid::createUuid()),
+    m_account(account),
     m_amount(amount),
     m_date(date),
-    m_budget(budget),
+    m_budget(BUDGETS.intern(budget)),
     m_srcdst(srcdst),
+    m_payment_method(PAYMENT_METHODS.intern(payment_method)),
     m_description(description),
-    m_payment_method(payment_method)
+    m_valid(true),
+    m_verified(verified),
+    m_scheduled(false)
+{
+
+}
+
+Operation::Operation(const Operation &prototype, const QDate &date) :
+    m_id(QUuid::createUuid()),
+    m_account(nullptr),
+    m_amount(prototype.m_amount),
+    m_date(date),
+    m_budget(prototype.m_budget),
+    m_srcdst(prototype.m_srcdst),
+    m_payment_method(prototype.m_payment_method),
+    m_description(prototype.m_description),
+    m_valid(true),
+    m_verified(true),
+    m_scheduled(true)
 {
 
 }
@@ -64,24 +98,32 @@ void Operation::update(bool verified,
                        const QString &description,
                        const QString &payment_method)
 {
+    QDate prev_date=m_date;
     m_verified=verified;
     m_amount=amount;
     m_date=date;
-    m_budget=budget;
+    m_budget=BUDGETS.intern(budget);
     m_srcdst=srcdst;
     m_description=description;
-    m_payment_method=payment_method;
-    emit modified();
+    m_payment_method=PAYMENT_METHODS.intern(payment_method);
+    notify_modified(prev_date);
 }
 
 void Operation::set_verified(bool verified)
 {
     if(m_verified!=verified) {
         m_verified=verified;
-        emit modified();
+        notify_modified(m_date);
     }
 }
 
+void Operation::notify_modified(const QDate &prev_date)
+{
+    /* generated or imported operations do not belong to an account yet */
+    if(m_account!=nullptr) {
+        m_account->operation_modified(this, prev_date);
+    }
+}
 
 bool Operation::read(const QJsonObject &json)
 {
@@ -100,10 +142,10 @@ bool Operation::read(const QJsonObject &json)
     m_date=QDate(json[KW_YEAR].toInt(),
                 json[KW_MONTH].toInt(),
                 json[KW_DAY].toInt());
-    m_budget=json[KW_BUDGET].toString();
+    m_budget=BUDGETS.intern(json[KW_BUDGET].toString());
     m_srcdst=json[KW_RECIPIENT].toString();
     m_description=json[KW_DESCRIPTION].toString();
-    m_payment_method=json[KW_PAYMENT_METHOD].toString();
+    m_payment_method=PAYMENT_METHODS.intern(json[KW_PAYMENT_METHOD].toString());
     if(json.contains(KW_VERIFIED)) {
         m_verified=json[KW_VERIFIED].toBool();
     }
@@ -119,10 +161,10 @@ bool Operation::write(QJsonObject &json) const
     json[KW_DAY]=m_date.day();
     json[KW_MONTH]=m_date.month();
     json[KW_YEAR]=m_date.year();
-    json[KW_BUDGET]=m_budget;
-    json[KW_RECIPIENT]=m_srcdst;
+    json[KW_BUDGET]=budget();
+    json[KW_RECIPIENT]=srcdst();
     json[KW_DESCRIPTION]=m_description;
-    json[KW_PAYMENT_METHOD]=m_payment_method;
+    json[KW_PAYMENT_METHOD]=payment_method();
     json[KW_VERIFIED]=m_verified;
     /**/
     LOG_BOOL_RETURN(true)
@@ -20,16 +20,19 @@
 
 #include "utils/macro.h"
 #include "utils/amount.h"
+#include "utils/symboltable.h"
 #include "model/picsoudbo.h"
 
 #include <QDate>
 
+class Account;
 class PaymentMethod;
 DECL_PICSOU_OBJ_PTR(PaymentMethod, PaymentMethodShPtr, PaymentMethodShPtrList);
 
-class Operation : public PicsouDBO
+/* operations are plain records rather than PicsouDBO objects, an account may
+   hold hundreds of thousands of them, changes are notified to the account */
+class Operation
 {
-    Q_OBJECT
 public:
     enum Type {
         NEUTRAL,
@@ -47,7 +50,13 @@ public:
     static const QString KW_DESCRIPTION;
     static const QString KW_PAYMENT_METHOD;
 
-    Operation(PicsouDBO *parent);
+    /* few distinct values shared by many operations, cleared when the database is closed */
+    static SymbolTable BUDGETS;
+    static SymbolTable PAYMENT_METHODS;
+
+    static void clear_symbols();
+
+    Operation(Account *account=nullptr);
     Operation(bool verified,
               const Amount &amount,
               const QDate &date,
@@ -55,7 +64,16 @@ public:
               const QString &srcdst,
               const QString &description,
               const QString &payment_method,
-              PicsouDBO *parent);
+              Account *account);
+    /* occurrence of a scheduled operation, see OperationCollection::list() */
+    Operation(const Operation &prototype, const QDate &date);
+
+    inline QUuid id() const { return m_id; }
+    inline bool valid() const { return m_valid; }
+    inline Account *account() const { return m_account; }
+
+    inline void set_id(QUuid id) { m_id=id; }
+    inline void set_account(Account *account) { m_account=account; }
 
     void update(bool verified,
                 Amount amount,
@@ -65,14 +83,15 @@ public:
                 const QString &description,
                 const QString &payment_method);
 
-    void mark_scheduled() { m_scheduled=true; }
-
     inline Amount amount() const { return m_amount; }
     inline QDate date() const { return m_date; }
-    inline QString budget() const { return m_budget; }
-    inline QString srcdst() const { return m_srcdst; }
-    inline QString description() const { return m_description; }
-    inline QString payment_method() const { return m_payment_method; }
+    inline QString budget() const { return BUDGETS.str(m_budget); }
+    inline const QString &srcdst() const { return m_srcdst; }
+    inline const QString &description() const { return m_description; }
+    inline QString payment_method() const { return PAYMENT_METHODS.str(m_payment_method); }
+
+    inline int budget_symbol() const { return m_budget; }
+    inline int payment_method_symbol() const { return m_payment_method; }
 
     inline Type type() const { return (m_amount==0.?NEUTRAL:(m_amount<0.?DEBIT:CREDIT)); }
 
@@ -87,14 +106,21 @@ public:
     inline bool operator<(const Operation &other) { return m_date<other.m_date; }
 
 private:
-    bool m_verified;
+    inline void set_valid(bool valid=true) { m_valid=valid; }
+    void notify_modified(const QDate &prev_date);
+
+private:
+    QUuid m_id;
+    Account *m_account;
     Amount m_amount;
     QDate m_date;
-    QString m_budget;
+    int m_budget;
     QString m_srcdst;
+    int m_payment_method;
     QString m_description;
-    QString m_payment_method;
-    bool m_scheduled=false;
+    bool m_valid;
+    bool m_verified;
+    bool m_scheduled;
 };
 
 DECL_PICSOU_OBJ_PTR(Operation, OperationShPtr, OperationShPtrList);
@@ -19,46 +19,66 @@
 #include "picsoudb.h"
 #include "utils/macro.h"
 
+#include <QJsonDocument>
+
 const QString PicsouDB::KW_NAME="name";
 const QString PicsouDB::KW_USERS="users";
 const QString PicsouDB::KW_VERSION="version";
 const QString PicsouDB::KW_TIMESTAMP="timestamp";
 const QString PicsouDB::KW_DESCRIPTION="description";
+const QString PicsouDB::KW_GENERATION="generation";
+const QString PicsouDB::KW_USER="user";
 
 PicsouDB::PicsouDB() :
-    PicsouDBO(false, nullptr)
+    PicsouDBO(false, nullptr),
+    m_batch_depth(0),
+    m_generation(0),
+    m_full_save_required(true),
+    m_accounts_indexed(false)
 {
-
+    connect(this, &PicsouDBO::unwrapped, this, &PicsouDB::invalidate_accounts);
 }
 
 PicsouDB::PicsouDB(SemVer version,
                    const QString &name,
                    const QString &description) :
     PicsouDBO(true, nullptr),
+    m_batch_depth(0),
+    m_generation(0),
+    m_full_save_required(true),
     m_timestamp(),
     m_version(version),
     m_name(name),
-    m_description(description)
+    m_description(description),
+    m_accounts_indexed(false)
 {
-
+    connect(this, &PicsouDBO::unwrapped, this, &PicsouDB::invalidate_accounts);
 }
 
 void PicsouDB::add_user(const QString &username, const QString &pswd)
 {
     UserShPtr user=UserShPtr(new User(username, pswd, this));
     m_users.insert(user->id(), user);
+    m_user_names.insert(user);
+    m_full_save_required=true;
     emit modified();
 }
 
 bool PicsouDB::remove_user(QUuid id, QString &error)
 {
     bool success=false;
+    UserShPtr user=m_users.value(id);
+    if(!user.isNull()) {
+        m_user_names.remove(user.data());
+    }
     switch (m_users.remove(id)) {
     case 0:
         error=tr("Failed to remove user from database: absent user.");
         break;
     case 1:
         success=true;
+        m_full_save_required=true;
+        invalidate_accounts();
         emit modified();
         break;
     default:
@@ -95,12 +115,7 @@ UserShPtr PicsouDB::find_user(QUuid id) const
 
 UserShPtr PicsouDB::find_user(const QString &name) const
 {
-    for(const auto &user : m_users.values()) {
-        if(user->name()==name) {
-            return user;
-        }
-    }
-    return UserShPtr();
+    return m_user_names.find(name, m_users);
 }
 
 OperationCollection PicsouDB::ops(QUuid account_id,
@@ -113,24 +128,19 @@ OperationCollection PicsouDB::ops(QUuid account_id,
         LOG_WARNING("failed to find account.")
         return OperationCollection();
     }
+    if(!until.isValid()) {
+        /* cached by the account, invalidated by the objects that change */
+        return account->collection(year, month);
+    }
     OperationCollection selected_ops(account->initial_amount());
     for(const auto &sop : account->scheduled_ops()) {
         LOG_DEBUG("sop->name="<<sop->name())
-        for(const auto &date : sop->schedule().dates(year, month)) {
+        for(const auto &date : account->occurrences(sop, year, month)) {
             LOG_DEBUG("generated date="<<date)
             if(until.isValid()&&date>until) {
                 break;
             }
-            Operation *op=new Operation(true,
-                                        sop->amount(),
-                                        date,
-                                        sop->budget(),
-                                        sop->srcdst(),
-                                        sop->description(),
-                                        sop->payment_method(),
-                                        account.data());
-            op->mark_scheduled();
-            selected_ops.append(OperationShPtr(op));
+            selected_ops.append(sop, date);
         }
     }
     for(const auto &op : account->ops()) {
@@ -148,19 +158,157 @@ OperationCollection PicsouDB::ops(QUuid account_id,
     return selected_ops;
 }
 
-AccountShPtr PicsouDB::find_account(QUuid id) const
+Forecast PicsouDB::forecast(QUuid id, const QDate &horizon) const
 {
-    AccountShPtr account;
-    for(const auto &user : m_users.values()) {
-        account=user->find_account(id);
+    AccountShPtrList accounts;
+    UserShPtr user=find_user(id);
+    if(!user.isNull()) {
+        accounts=user->accounts();
+    } else {
+        AccountShPtr account=find_account(id);
         if(account.isNull()) {
+            LOG_WARNING("failed to find user or account to forecast.")
+            return Forecast();
+        }
+        accounts.append(account);
+    }
+    return Forecast(accounts, (horizon.isValid()?
+                                   horizon:
+                                   QDate::currentDate().addYears(Forecast::DEFAULT_HORIZON_YEARS)));
+}
+
+AccountShPtr PicsouDB::find_account(QUuid id) const
+{
+    if(!m_accounts_indexed) {
+        index_accounts();
+    }
+    return m_accounts.value(id);
+}
+
+void PicsouDB::invalidate_accounts()
+{
+    m_accounts_indexed=false;
+    m_accounts.clear();
+}
+
+void PicsouDB::index_accounts() const
+{
+    m_accounts.clear();
+    for(const auto &user : m_users) {
+        for(const auto &account : user->accounts()) {
+            /* an invalid account never shadows a valid one */
+            if(account->valid()||!m_accounts.contains(account->id())) {
+                m_accounts.insert(account->id(), account);
+            }
+        }
+    }
+    m_accounts_indexed=true;
+}
+
+bool PicsouDB::requires_full_save() const
+{
+    if(m_full_save_required) {
+        return true;
+    }
+    for(const auto &user : m_users) {
+        if(user->wrapped_dirty()) {
+            return true;
+        }
+        /* locked users are written back as is */
+        if(!user->wrapped()&&!user->journal_ready()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PicsouDB::write_journal(QList<QByteArray> &records) const
+{
+    LOG_IN("records")
+    QString wdat;
+    QJsonObject json;
+    for(const auto &user : m_users) {
+        if(user->wrapped()||!user->journal_dirty()) {
             continue;
         }
-        if(account->valid()) {
-            break;
+        if(!user->write_journal(wdat)) {
+            LOG_BOOL_RETURN(false)
         }
+        json=QJsonObject();
+        json[KW_USER]=user->id().toString();
+        json[KW_WDAT]=wdat;
+        records.append(QJsonDocument(json).toJson(QJsonDocument::Compact));
+    }
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouDB::read_journal(const QJsonObject &json)
+{
+    LOG_IN("<QJsonObject>")
+    UserShPtr user=find_user(QUuid(json[KW_USER].toString()));
+    if(user.isNull()) {
+        LOG_WARNING("journal record refers to an unknown user.")
+        LOG_BOOL_RETURN(false)
+    }
+    user->append_journal(json[KW_WDAT].toString());
+    LOG_BOOL_RETURN(true)
+}
+
+void PicsouDB::mark_saved()
+{
+    m_full_save_required=false;
+    for(const auto &user : m_users) {
+        user->mark_saved();
+    }
+}
+
+void PicsouDB::begin_batch()
+{
+    m_batch_depth++;
+}
+
+void PicsouDB::end_batch()
+{
+    if(m_batch_depth==0) {
+        LOG_WARNING("end_batch() called outside of a batch.")
+        return;
     }
-    return account;
+    m_batch_depth--;
+    if(m_batch_depth==0&&!m_pending_changes.empty()) {
+        ChangeSet changes=m_pending_changes;
+        m_pending_changes.clear();
+        emit changed(changes);
+    }
+}
+
+void PicsouDB::track_modified(PicsouDBO *dbo)
+{
+    User *user=qobject_cast<User*>(dbo);
+    if(user!=nullptr) {
+        /* user may have been renamed, accounts added or removed */
+        m_user_names.check(user);
+        invalidate_accounts();
+    } else if(qobject_cast<Budget*>(dbo)!=nullptr&&dbo->parent_dbo()!=nullptr) {
+        m_pending_changes.insert_budgets_of(dbo->parent_dbo()->id());
+    }
+    /* changes made by this object or its descendants are reported to
+       listeners of this object, once per batch */
+    for(PicsouDBO *it=dbo; it!=nullptr; it=it->parent_dbo()) {
+        m_pending_changes.insert(it->id());
+    }
+    begin_batch();
+    end_batch();
+}
+
+PicsouDBBatch::PicsouDBBatch(const PicsouDBShPtr &db) :
+    m_db(db)
+{
+    m_db->begin_batch();
+}
+
+PicsouDBBatch::~PicsouDBBatch()
+{
+    m_db->end_batch();
 }
 
 bool PicsouDB::read(const QJsonObject &json)
@@ -196,7 +344,16 @@ bool PicsouDB::read(const QJsonObject &json)
     /**/
     m_name=json[KW_NAME].toString();
     m_description=json[KW_DESCRIPTION].toString();
+    /* files written before journaling lack identifiers, the first save must be complete */
+    m_full_save_required=!json.contains(KW_GENERATION);
+    m_generation=json[KW_GENERATION].toInt();
     JSON_READ_LIST(json, KW_USERS, m_users, User, this);
+    /* payloads of a journaled file carry identifiers, users need not be unlocked to be journaled */
+    for(const auto &user : m_users) {
+        user->set_journal_ready(!m_full_save_required);
+    }
+    m_user_names.invalidate();
+    invalidate_accounts();
     /**/
     set_valid();
     LOG_BOOL_RETURN(valid())
@@ -204,14 +361,45 @@ bool PicsouDB::read(const QJsonObject &json)
 
 bool PicsouDB::write(QJsonObject &json) const
 {
-    QJsonObject obj;
-    QJsonArray array;
-    /**/
-    json[KW_NAME]=m_name;
-    json[KW_VERSION]=m_version.to_str();
-    json[KW_DESCRIPTION]=m_description;
-    json[KW_TIMESTAMP]=QDate::currentDate().toString(Qt::ISODate);
-    JSON_WRITE_LIST(json, KW_USERS, m_users.values());
-    /**/
+    LOG_IN("<QJsonObject>")
+    Snapshot snapshot;
+    if(!PicsouDB::snapshot(snapshot)) {
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_BOOL_RETURN(snapshot.wrap(json))
+}
+
+bool PicsouDB::snapshot(Snapshot &snapshot) const
+{
+    LOG_IN("<Snapshot>")
+    snapshot.json[KW_NAME]=m_name;
+    snapshot.json[KW_VERSION]=m_version.to_str();
+    snapshot.json[KW_DESCRIPTION]=m_description;
+    snapshot.json[KW_GENERATION]=m_generation;
+    snapshot.json[KW_TIMESTAMP]=QDate::currentDate().toString(Qt::ISODate);
+    for(const auto &user : m_users) {
+        User::Snapshot user_snapshot;
+        if(!user->snapshot(user_snapshot)) {
+            LOG_BOOL_RETURN(false)
+        }
+        user_snapshot.json[KW_ID]=user->id().toString();
+        snapshot.users.append(user_snapshot);
+    }
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouDB::Snapshot::wrap(QJsonObject &wrapped) const
+{
+    LOG_IN("<QJsonObject>")
+    QJsonObject user_json;
+    QJsonArray user_ary;
+    wrapped=json;
+    for(const auto &user : users) {
+        if(!user.wrap(user_json)) {
+            LOG_BOOL_RETURN(false)
+        }
+        user_ary.append(user_json);
+    }
+    wrapped[KW_USERS]=user_ary;
     LOG_BOOL_RETURN(true)
 }
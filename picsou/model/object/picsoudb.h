@@ -20,6 +20,9 @@
 
 #include "utils/semver.h"
 #include "model/object/user.h"
+#include "model/changeset.h"
+#include "model/nameindex.h"
+#include "model/forecast.h"
 #include "model/operationcollection.h"
 
 class PicsouDB : public PicsouDBO
@@ -31,6 +34,18 @@ public:
     static const QString KW_VERSION;
     static const QString KW_TIMESTAMP;
     static const QString KW_DESCRIPTION;
+    static const QString KW_GENERATION;
+    static const QString KW_USER;
+
+    /* cheap copy of the database taken on the thread owning it, wrap() does
+       the encryption and may run on any thread */
+    struct Snapshot
+    {
+        QJsonObject json;
+        QList<User::Snapshot> users;
+
+        bool wrap(QJsonObject &wrapped) const;
+    };
 
     PicsouDB();
     PicsouDB(SemVer version,
@@ -44,6 +59,8 @@ public:
     inline SemVer version() const { return m_version; }
     inline QString name() const { return m_name; }
     inline QString description() const { return m_description; }
+    inline int generation() const { return m_generation; }
+    inline void next_generation() { m_generation++; }
 
     UserShPtr find_user(QUuid id) const;
     UserShPtr find_user(const QString &name) const;
@@ -55,19 +72,64 @@ public:
                             int year=-1,
                             int month=-1,
                             const QDate &until=QDate()) const;
+    /* id is the one of an account or of a user, default horizon is a few years ahead */
+    Forecast forecast(QUuid id, const QDate &horizon=QDate()) const;
+
+
+    bool requires_full_save() const;
+    inline void require_full_save() { m_full_save_required=true; }
+    bool write_journal(QList<QByteArray> &records) const;
+    bool read_journal(const QJsonObject &json);
+    void mark_saved();
 
+    void begin_batch();
+    void end_batch();
 
     bool read(const QJsonObject &json);
     bool write(QJsonObject &json) const;
+    bool snapshot(Snapshot &snapshot) const;
+
+signals:
+    void changed(const ChangeSet &changes);
+
+protected:
+    void track_modified(PicsouDBO *dbo);
+
+private slots:
+    void invalidate_accounts();
+
+private:
+    void index_accounts() const;
 
 private:
+    int m_batch_depth;
+    ChangeSet m_pending_changes;
+    int m_generation;
+    bool m_full_save_required;
     QDate m_timestamp;
     SemVer m_version;
     QString m_name;
     QString m_description;
     QHash<QUuid, UserShPtr> m_users;
+    NameIndex<User> m_user_names;
+    /* accounts of all unwrapped users, rebuilt when users add or remove accounts */
+    mutable QHash<QUuid, AccountShPtr> m_accounts;
+    mutable bool m_accounts_indexed;
 };
 
 DECL_PICSOU_OBJ_PTR(PicsouDB, PicsouDBShPtr, PicsouDBShPtrList);
 
+/* coalesces modifications made during its lifetime into a single change set */
+class PicsouDBBatch
+{
+public:
+    explicit PicsouDBBatch(const PicsouDBShPtr &db);
+    ~PicsouDBBatch();
+
+private:
+    Q_DISABLE_COPY(PicsouDBBatch)
+
+    PicsouDBShPtr m_db;
+};
+
 #endif // PICSOUDB_H
@@ -21,7 +21,7 @@
 const QString ScheduledOperation::KW_NAME="name";
 
 ScheduledOperation::ScheduledOperation(PicsouDBO *parent) :
-    Operation(parent)
+    PicsouDBO(false, parent)
 {
 
 }
@@ -34,16 +34,17 @@ ScheduledOperation::ScheduledOperation(const Amount &amount,
                                        const QString &name,
                                        const Schedule &schedule,
                                        PicsouDBO *parent) :
-    Operation(false,
-              amount,
-              QDate(),
-              budget,
-              srcdst,
-              description,
-              payment_method,
-              parent),
+    PicsouDBO(true, parent),
     m_name(name),
-    m_schedule(schedule)
+    m_schedule(schedule),
+    m_template(false,
+               amount,
+               QDate(),
+               budget,
+               srcdst,
+               description,
+               payment_method,
+               nullptr)
 {
 
 }
@@ -58,13 +59,14 @@ void ScheduledOperation::update(const Amount &amount,
 {
     m_name=name;
     m_schedule=schedule;
-    Operation::update(false,
+    m_template.update(false,
                       amount,
                       QDate(),
                       budget,
                       srcdst,
                       description,
                       payment_method);
+    emit modified();
 }
 
 bool ScheduledOperation::read(const QJsonObject &json)
@@ -94,7 +96,7 @@ bool ScheduledOperation::read(const QJsonObject &json)
     m_schedule=Schedule(QDate(start_y, start_m, start_d),
                        QDate(stop_y, stop_m, stop_d),
                        endless, freq_value, freq_unit);
-    set_valid(Operation::read(json));
+    set_valid(m_template.read(json));
     LOG_BOOL_RETURN(valid())
 }
 
@@ -111,5 +113,5 @@ bool ScheduledOperation::write(QJsonObject &json) const
     json[Schedule::KW_ENDLESS]=m_schedule.endless();
     json[Schedule::KW_FREQ_VALUE]=m_schedule.freq_value();
     json[Schedule::KW_FREQ_UNIT]=Schedule::freq_unit2str(m_schedule.freq_unit());
-    LOG_BOOL_RETURN(Operation::write(json))
+    LOG_BOOL_RETURN(m_template.write(json))
 }
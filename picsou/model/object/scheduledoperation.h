@@ -22,7 +22,7 @@
 #include "utils/schedule.h"
 
 
-class ScheduledOperation : public Operation
+class ScheduledOperation : public PicsouDBO
 {
     Q_OBJECT
 public:
@@ -40,6 +40,15 @@ public:
 
     inline QString name() const { return m_name; }
     inline Schedule schedule() const { return m_schedule; }
+    inline Amount amount() const { return m_template.amount(); }
+    inline QString budget() const { return m_template.budget(); }
+    inline QString srcdst() const { return m_template.srcdst(); }
+    inline QString description() const { return m_template.description(); }
+    inline QString payment_method() const { return m_template.payment_method(); }
+    /* fields shared by all occurrences, its date is invalid */
+    inline const Operation &prototype() const { return m_template; }
+    inline Schedule::Occurrences occurrences(int year=-1, int month=-1) const { return m_schedule.occurrences(year, month); }
+    inline Schedule::Occurrences occurrences(const QDate &from, const QDate &to) const { return m_schedule.occurrences(from, to); }
 
     void update(const Amount &amount,
                 const QString &budget,
@@ -55,6 +64,8 @@ public:
 private:
     QString m_name;
     Schedule m_schedule;
+    /* fields copied to every generated operation */
+    Operation m_template;
 };
 
 DECL_PICSOU_OBJ_PTR(ScheduledOperation, ScheduledOperationShPtr, ScheduledOperationShPtrList);
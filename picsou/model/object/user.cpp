@@ -17,21 +17,33 @@
  */
 #include "user.h"
 #include "utils/macro.h"
+#include "model/columnardocument.h"
+
+#include <QJsonDocument>
 
 
 const QString User::KW_NAME="name";
 const QString User::KW_BUDGETS="budgets";
 const QString User::KW_ACCOUNTS="accounts";
+const QString User::KW_JOURNAL="journal";
+const QString User::KW_REMOVED_ACCOUNTS="removed_accounts";
+const QString User::KW_SEGMENTS="segments";
 
 User::User(PicsouDBO *parent) :
-    PicsouDBO(false, parent)
+    PicsouDBO(false, parent),
+    m_journal_ready(false),
+    m_wrapped_dirty(false),
+    m_budgets_dirty(false)
 {
 
 }
 
 User::User(const QString &name, const QString &pswd, PicsouDBO *parent) :
     PicsouDBO(true, parent),
-    m_name(name)
+    m_name(name),
+    m_journal_ready(false),
+    m_wrapped_dirty(true),
+    m_budgets_dirty(false)
 {
     PicsouDBO::init_wkey(pswd);
 }
@@ -64,20 +76,26 @@ bool User::add_budget(const Amount &amount, const QString &name, const QString &
     }
     BudgetShPtr budget=BudgetShPtr(new Budget(amount, name, description, this));
     m_budgets.insert(budget->id(), budget);
-    emit modified();
+    m_budget_names.insert(budget);
+    track_modified(budget.data());
     return true;
 }
 
 bool User::remove_budget(QUuid id)
 {
     bool success=false;
+    BudgetShPtr budget=m_budgets.value(id);
+    if(!budget.isNull()) {
+        m_budget_names.remove(budget.data());
+    }
     switch (m_budgets.remove(id)) {
     case 0:
         /* TRACE */
         break;
     case 1:
         success=true;
-        emit modified();
+        /* removed budget still refers to this user */
+        track_modified(budget.data());
         break;
     default:
         /* TRACE */
@@ -95,20 +113,26 @@ bool User::add_account(const QString &name, const QString &notes, bool archived,
     }
     AccountShPtr account=AccountShPtr(new Account(name, notes, archived, initial_amount, this));
     m_accounts.insert(account->id(), account);
-    emit modified();
+    m_account_names.insert(account);
+    PicsouDBO::track_modified(this);
     return true;
 }
 
 bool User::remove_account(QUuid id)
 {
     bool success=false;
+    AccountShPtr account=m_accounts.value(id);
+    if(!account.isNull()) {
+        m_account_names.remove(account.data());
+    }
     switch (m_accounts.remove(id)) {
     case 0:
         /* TRACE */
         break;
     case 1:
         success=true;
-        emit modified();
+        m_removed_accounts.insert(id);
+        PicsouDBO::track_modified(this);
         break;
     default:
         /* TRACE */
@@ -167,12 +191,7 @@ BudgetShPtr User::find_budget(QUuid id) const
 
 BudgetShPtr User::find_budget(const QString &name) const
 {
-    for(const auto &budget : m_budgets) {
-        if(budget->name()==name) {
-            return budget;
-        }
-    }
-    return BudgetShPtr();
+    return m_budget_names.find(name, m_budgets);
 }
 
 AccountShPtr User::find_account(QUuid id) const
@@ -187,12 +206,7 @@ AccountShPtr User::find_account(QUuid id) const
 
 AccountShPtr User::find_account(const QString &name) const
 {
-    for(const auto &account : m_accounts) {
-        if(account->name()==name) {
-            return account;
-        }
-    }
-    return AccountShPtr();
+    return m_account_names.find(name, m_accounts);
 }
 
 bool User::read(const QJsonObject &json)
@@ -201,6 +215,10 @@ bool User::read(const QJsonObject &json)
     static const QStringList keys=(QStringList()<<KW_NAME);
     JSON_CHECK_KEYS(keys);
     m_name=json[KW_NAME].toString();
+    for(const auto record : json[KW_JOURNAL].toArray()) {
+        m_journal.append(record.toString());
+    }
+    m_segments=json[KW_SEGMENTS].toObject();
     set_valid(PicsouDBO::read_wrapped(json));
     LOG_BOOL_RETURN(valid())
 }
@@ -208,8 +226,67 @@ bool User::read(const QJsonObject &json)
 bool User::write(QJsonObject &json) const
 {
     LOG_IN("<QJsonObject>")
-    json[KW_NAME]=m_name;
-    LOG_BOOL_RETURN(PicsouDBO::write_wrapped(json))
+    Snapshot snapshot;
+    if(!User::snapshot(snapshot)) {
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_BOOL_RETURN(snapshot.wrap(json))
+}
+
+bool User::snapshot(Snapshot &snapshot) const
+{
+    LOG_IN("<Snapshot>")
+    snapshot.json[KW_NAME]=m_name;
+    if(!m_journal.isEmpty()) {
+        /* records not replayed yet must survive a compaction */
+        snapshot.json[KW_JOURNAL]=QJsonArray::fromStringList(m_journal);
+    }
+    if(wrapped()) {
+        snapshot.json[KW_SEGMENTS]=m_segments;
+    } else {
+        /* segments of accounts which were not modified are written back as is */
+        QString wseg;
+        QJsonObject segments;
+        for(const auto &account : m_accounts) {
+            Deferred deferred;
+            if(!account->snapshot_segment(wseg, deferred)) {
+                LOG_BOOL_RETURN(false)
+            }
+            if(deferred.pending()) {
+                snapshot.segments.insert(account->id().toString(), deferred);
+            } else {
+                segments[account->id().toString()]=wseg;
+            }
+        }
+        snapshot.json[KW_SEGMENTS]=segments;
+    }
+    LOG_BOOL_RETURN(PicsouDBO::write_wrapped(snapshot.json, snapshot.data))
+}
+
+bool User::Snapshot::wrap(QJsonObject &wrapped) const
+{
+    LOG_IN("<QJsonObject>")
+    QString wdata;
+    wrapped=json;
+    if(data.pending()) {
+        if(!data.wrap(wdata)) {
+            LOG_CRITICAL("failed to wrap user data.")
+            LOG_BOOL_RETURN(false)
+        }
+        wrapped[KW_WDAT]=wdata;
+    }
+    if(!segments.isEmpty()) {
+        QJsonObject wsegs=wrapped[KW_SEGMENTS].toObject();
+        for(auto it=segments.constBegin(); it!=segments.constEnd(); ++it) {
+            if(!it->wrap(wdata)) {
+                LOG_CRITICAL("failed to wrap account segment.")
+                LOG_BOOL_RETURN(false)
+            }
+            wsegs[it.key()]=wdata;
+        }
+        wrapped[KW_SEGMENTS]=wsegs;
+    }
+    LOG_BOOL_RETURN(true)
 }
 
 bool User::read_unwrapped(const QJsonObject &json)
@@ -232,6 +309,208 @@ bool User::write_unwrapped(QJsonObject &json) const
     LOG_BOOL_RETURN(true)
 }
 
+bool User::read_unwrapped(const QByteArray &data)
+{
+    LOG_IN("data.size="<<data.size())
+    bool success;
+    m_journal_ready=false;
+    if(ColumnarDocument::detect(data)) {
+        success=read_columnar(data);
+    } else {
+        /* payload written before columnar encoding was introduced */
+        success=PicsouDBO::read_unwrapped(data);
+    }
+    if(success) {
+        /* accounts now own their segments */
+        m_segments=QJsonObject();
+        success=replay_journal();
+    }
+    /* budgets and accounts were replaced */
+    m_budget_names.invalidate();
+    m_account_names.invalidate();
+    LOG_BOOL_RETURN(success)
+}
+
+bool User::write_unwrapped(QByteArray &data) const
+{
+    LOG_IN("<QByteArray>")
+    QJsonObject json, account_json;
+    QJsonArray account_ary;
+    JSON_WRITE_LIST(json, KW_BUDGETS, m_budgets.values());
+    for(const auto &account : m_accounts) {
+        account_json=QJsonObject();
+        if(!account->write_properties(account_json)) {
+            LOG_BOOL_RETURN(false)
+        }
+        account_json[KW_ID]=account->id().toString();
+        account_ary.append(account_json);
+    }
+    json[KW_ACCOUNTS]=account_ary;
+    /* operations are stored in per-account segments, see write() */
+    data=ColumnarDocument::encode(json, QList<OperationShPtrList>());
+    LOG_BOOL_RETURN(true)
+}
+
+bool User::journal_dirty() const
+{
+    if(m_budgets_dirty||!m_removed_accounts.isEmpty()) {
+        return true;
+    }
+    for(const auto &account : m_accounts) {
+        if(account->journal_dirty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool User::write_journal(QString &record) const
+{
+    LOG_IN("record")
+    QJsonObject json, account_json;
+    QJsonArray account_ary, removed_ary;
+    if(m_budgets_dirty) {
+        JSON_WRITE_LIST(json, KW_BUDGETS, m_budgets.values());
+    }
+    for(const auto &account : m_accounts) {
+        if(!account->journal_dirty()) {
+            continue;
+        }
+        account_json=QJsonObject();
+        if(!account->write_journal(account_json)) {
+            LOG_BOOL_RETURN(false)
+        }
+        account_ary.append(account_json);
+    }
+    for(const auto &account_id : m_removed_accounts) {
+        removed_ary.append(account_id.toString());
+    }
+    json[KW_ACCOUNTS]=account_ary;
+    json[KW_REMOVED_ACCOUNTS]=removed_ary;
+    if(!wrap_data(QJsonDocument(json).toJson(QJsonDocument::Compact), record)) {
+        LOG_CRITICAL("failed to wrap journal record.")
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_BOOL_RETURN(true)
+}
+
+void User::append_journal(const QString &record)
+{
+    m_journal.append(record);
+}
+
+void User::mark_saved()
+{
+    m_journal_ready=true;
+    m_wrapped_dirty=false;
+    m_budgets_dirty=false;
+    m_removed_accounts.clear();
+    for(const auto &account : m_accounts) {
+        account->mark_saved();
+    }
+}
+
+void User::track_modified(PicsouDBO *dbo)
+{
+    if(dbo==this) {
+        /* name and wrapping key are stored outside of wrapped data */
+        m_wrapped_dirty=true;
+    } else if(qobject_cast<Budget*>(dbo)!=nullptr) {
+        m_budgets_dirty=true;
+        m_budget_names.check(static_cast<Budget*>(dbo));
+    } else if(qobject_cast<Account*>(dbo)!=nullptr) {
+        m_account_names.check(static_cast<Account*>(dbo));
+    }
+    PicsouDBO::track_modified(dbo);
+}
+
+bool User::read_columnar(const QByteArray &data)
+{
+    LOG_IN("data.size="<<data.size())
+    ColumnarDocument doc(data);
+    if(!doc.valid()) {
+        LOG_CRITICAL("invalid columnar document.")
+        set_valid(false);
+        LOG_BOOL_RETURN(false)
+    }
+    QJsonObject json=doc.header();
+    static const QStringList keys=(QStringList()<<KW_BUDGETS
+                                                <<KW_ACCOUNTS);
+    JSON_CHECK_KEYS(keys);
+    JSON_READ_LIST(json, KW_BUDGETS, m_budgets, Budget, this);
+    QJsonArray account_ary=json[KW_ACCOUNTS].toArray();
+    /* documents without blocks keep operations in per-account segments */
+    bool segmented=(doc.block_count()==0);
+    if(!segmented&&account_ary.size()!=doc.block_count()) {
+        LOG_CRITICAL("account count does not match column block count.")
+        set_valid(false);
+        LOG_BOOL_RETURN(false)
+    }
+    for(int i=0; i<account_ary.size(); ++i) {
+        QJsonObject account_json=account_ary[i].toObject();
+        QString account_id=account_json[KW_ID].toString();
+        if(segmented&&!m_segments.contains(account_id)) {
+            /* reading it as empty would overwrite its operations on next save */
+            LOG_CRITICAL("segment of account "<<account_id<<" is missing.")
+            set_valid(false);
+            LOG_BOOL_RETURN(false)
+        }
+        AccountShPtr account=AccountShPtr(new Account(this));
+        bool success=(segmented?
+                          account->read_segmented(account_json, m_segments.value(account_id).toString()):
+                          account->read(account_json, doc.block(i)));
+        if(!success) {
+            set_valid(false);
+            LOG_BOOL_RETURN(false)
+        }
+        if(!account_id.isNull()) {
+            account->set_id(QUuid(account_id));
+        }
+        m_accounts.insert(account->id(), account);
+    }
+    /* identifiers are persisted since version 2, journal records rely on them */
+    m_journal_ready=(doc.version()>=2);
+    set_valid(true);
+    LOG_BOOL_RETURN(valid())
+}
+
+bool User::replay_journal()
+{
+    LOG_IN_VOID()
+    for(const auto &record : m_journal) {
+        QByteArray data;
+        if(!unwrap_data(record, data)) {
+            LOG_CRITICAL("failed to unwrap journal record.")
+            LOG_BOOL_RETURN(false)
+        }
+        QJsonObject json=QJsonDocument::fromJson(data).object();
+        if(json.contains(KW_BUDGETS)) {
+            m_budgets.clear();
+            JSON_READ_LIST(json, KW_BUDGETS, m_budgets, Budget, this);
+        }
+        for(const auto account_id : json[KW_REMOVED_ACCOUNTS].toArray()) {
+            m_accounts.remove(QUuid(account_id.toString()));
+        }
+        for(const auto account_ref : json[KW_ACCOUNTS].toArray()) {
+            QJsonObject account_json=account_ref.toObject();
+            QUuid account_id(account_json[KW_ID].toString());
+            AccountShPtr account=find_account(account_id);
+            if(account.isNull()) {
+                account=AccountShPtr(new Account(this));
+                account->set_id(account_id);
+                m_accounts.insert(account_id, account);
+            }
+            if(!account->replay_journal(account_json)) {
+                set_valid(false);
+                LOG_BOOL_RETURN(false)
+            }
+        }
+    }
+    LOG_DEBUG("replayed "<<m_journal.size()<<" journal records.")
+    m_journal.clear();
+    LOG_BOOL_RETURN(true)
+}
+
 bool User::operator <(const User &other)
 {
     return (m_name<other.m_name);
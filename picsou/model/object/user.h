@@ -20,7 +20,9 @@
 
 #include "budget.h"
 #include "account.h"
+#include "model/nameindex.h"
 
+#include <QSet>
 #include <QHash>
 
 class User : public PicsouDBO
@@ -30,6 +32,19 @@ public:
     static const QString KW_NAME;
     static const QString KW_BUDGETS;
     static const QString KW_ACCOUNTS;
+    static const QString KW_JOURNAL;
+    static const QString KW_REMOVED_ACCOUNTS;
+    static const QString KW_SEGMENTS;
+
+    /* plaintext payloads of a user, wrapped by wrap() which may run on any thread */
+    struct Snapshot
+    {
+        QJsonObject json;
+        Deferred data;
+        QHash<QString, Deferred> segments;
+
+        bool wrap(QJsonObject &wrapped) const;
+    };
 
     User(PicsouDBO *parent);
     User(const QString &name,
@@ -66,15 +81,44 @@ public:
 
     bool read(const QJsonObject &json);
     bool write(QJsonObject &json) const;
+    bool snapshot(Snapshot &snapshot) const;
     bool read_unwrapped(const QJsonObject &json);
     bool write_unwrapped(QJsonObject &json) const;
+    bool read_unwrapped(const QByteArray &data);
+    bool write_unwrapped(QByteArray &data) const;
+
+    inline bool journal_ready() const { return m_journal_ready; }
+    inline void set_journal_ready(bool ready) { m_journal_ready=ready; }
+    inline bool wrapped_dirty() const { return m_wrapped_dirty; }
+    bool journal_dirty() const;
+    bool write_journal(QString &record) const;
+    void append_journal(const QString &record);
+    void mark_saved();
 
     bool operator <(const User &other);
 
+protected:
+    void track_modified(PicsouDBO *dbo);
+
+private:
+    bool read_columnar(const QByteArray &data);
+    bool replay_journal();
+
 private:
     QString m_name;
     QHash<QUuid, BudgetShPtr> m_budgets;
     QHash<QUuid, AccountShPtr> m_accounts;
+    NameIndex<Budget> m_budget_names;
+    NameIndex<Account> m_account_names;
+    /* changes since last save */
+    bool m_journal_ready;
+    bool m_wrapped_dirty;
+    bool m_budgets_dirty;
+    QSet<QUuid> m_removed_accounts;
+    /* wrapped journal records waiting for unwrap() */
+    QStringList m_journal;
+    /* wrapped account segments waiting for unwrap() */
+    QJsonObject m_segments;
 };
 
 DECL_PICSOU_OBJ_PTR(User, UserShPtr, UserShPtrList);
@@ -17,6 +17,33 @@
  */
 #include "operationcollection.h"
 #include "utils/macro.h"
+#include "object/account.h"
+
+#include <iterator>
+#include <algorithm>
+
+static void accumulate(QVector<Amount> &totals, QBitArray &seen, int symbol, const Amount &amount)
+{
+    if(symbol>=totals.size()) {
+        totals.resize(symbol+1);
+        seen.resize(symbol+1);
+    }
+    totals[symbol]+=amount;
+    seen.setBit(symbol);
+}
+
+static QHash<QString, Amount> symbol_totals(const QVector<Amount> &totals,
+                                            const QBitArray &seen,
+                                            const SymbolTable &symbols)
+{
+    QHash<QString, Amount> totals_per_str;
+    for(int symbol=0; symbol<totals.size(); ++symbol) {
+        if(seen.testBit(symbol)) {
+            totals_per_str.insert(symbols.str(symbol), totals.at(symbol));
+        }
+    }
+    return totals_per_str;
+}
 
 OperationCollection::OperationCollection(const Amount &initial_value) :
     m_initial_value(initial_value)
@@ -36,33 +63,155 @@ OperationCollection::OperationCollection(const OperationShPtrList &ops, const Am
 void OperationCollection::clear()
 {
     m_ops.clear();
+    m_sorted=true;
+    m_occurrences.clear();
+    m_occurrences_sorted=true;
     m_balance=0;
     m_total_debit=0;
     m_total_credit=0;
+    m_expense_per_pm.clear();
     m_expense_per_budget.clear();
+    m_pm_seen.clear();
+    m_budget_seen.clear();
 }
 
 void OperationCollection::append(const OperationShPtr &op)
 {
-    aggregate(op.data());
+    aggregate(op.data(), op->date());
+    store(op);
+}
+
+void OperationCollection::append(const ScheduledOperationShPtr &sop, const QDate &date)
+{
+    aggregate(&sop->prototype(), date);
+    store(sop, date);
+}
+
+void OperationCollection::append(const OperationCollection &other)
+{
+    for(const auto &op : other.m_ops) {
+        append(op);
+    }
+    for(const auto &occurrence : other.m_occurrences) {
+        append(occurrence.sop, occurrence.date);
+    }
+}
+
+void OperationCollection::store(const OperationShPtr &op)
+{
+    if(!m_ops.isEmpty()&&op->date()<m_ops.last()->date()) {
+        m_sorted=false;
+    }
     m_ops.append(op);
 }
 
+void OperationCollection::store(const ScheduledOperationShPtr &sop, const QDate &date)
+{
+    if(!m_occurrences.isEmpty()&&date<m_occurrences.last().date) {
+        m_occurrences_sorted=false;
+    }
+    m_occurrences.append(Occurrence{sop, date});
+}
+
+void OperationCollection::aggregate(const Rollup &rollup, const QDate &from, const QDate &to, int month)
+{
+    Rollup::Months::const_iterator it, last;
+    rollup.range(from, to, it, last);
+    for(; it!=last; ++it) {
+        /* month of every year when no period is given */
+        if(month!=-1&&it.key()%12!=month-1) {
+            continue;
+        }
+        m_years.insert(it.key()/12);
+        m_months.insert(it.key()%12+1);
+        for(Rollup::MonthCells::const_iterator cell=it->constBegin(); cell!=it->constEnd(); ++cell) {
+            Amount total=Amount::from_minor_units(cell->total);
+            m_balance+=total;
+            m_total_debit+=Amount::from_minor_units(cell->debit);
+            m_total_credit+=Amount::from_minor_units(cell->credit);
+            accumulate(m_expense_per_budget, m_budget_seen, cell.key().first, total);
+            accumulate(m_expense_per_pm, m_pm_seen, cell.key().second, total);
+        }
+    }
+}
+
+QHash<QString, Amount> OperationCollection::expense_per_pm() const
+{
+    return symbol_totals(m_expense_per_pm, m_pm_seen, Operation::PAYMENT_METHODS);
+}
+
+QHash<QString, Amount> OperationCollection::expense_per_budget() const
+{
+    return symbol_totals(m_expense_per_budget, m_budget_seen, Operation::BUDGETS);
+}
+
 bool op_cmp(const OperationShPtr &a, const OperationShPtr &b)
 {
     return a->date()<b->date();
 }
 
+static bool view_cmp(const OperationView &a, const OperationView &b)
+{
+    return a.date<b.date;
+}
+
+QVector<OperationView> OperationCollection::views(bool sorted) const
+{
+    QVector<OperationView> recorded, generated;
+    recorded.reserve(m_ops.size());
+    for(const auto &op : m_ops) {
+        recorded.append(OperationView(op.data(), op->date(), false, op->account()));
+    }
+    generated.reserve(m_occurrences.size());
+    for(const auto &occurrence : m_occurrences) {
+        generated.append(OperationView(&occurrence.sop->prototype(),
+                                       occurrence.date,
+                                       true,
+                                       qobject_cast<Account*>(occurrence.sop->parent_dbo())));
+    }
+    if(!sorted) {
+        return recorded+generated;
+    }
+    /* collections built by an account are already ordered */
+    if(!m_sorted) {
+        std::stable_sort(recorded.begin(), recorded.end(), view_cmp);
+    }
+    if(!m_occurrences_sorted) {
+        std::stable_sort(generated.begin(), generated.end(), view_cmp);
+    }
+    QVector<OperationView> views;
+    views.reserve(recorded.size()+generated.size());
+    std::merge(recorded.constBegin(), recorded.constEnd(),
+               generated.constBegin(), generated.constEnd(),
+               std::back_inserter(views), view_cmp);
+    return views;
+}
+
 OperationShPtrList OperationCollection::list(bool sorted) const
 {
-    OperationShPtrList ops=m_ops;
-    if(sorted) {
+    OperationShPtrList ops=m_ops, generated;
+    /* occurrences are instanciated for callers needing operation objects */
+    for(const auto &occurrence : m_occurrences) {
+        generated.append(OperationShPtr::create(occurrence.sop->prototype(), occurrence.date));
+    }
+    if(!sorted) {
+        return ops+generated;
+    }
+    if(!m_sorted) {
         std::sort(ops.begin(), ops.end(), op_cmp);
     }
-    return ops;
+    if(!m_occurrences_sorted) {
+        std::stable_sort(generated.begin(), generated.end(), op_cmp);
+    }
+    OperationShPtrList merged;
+    merged.reserve(ops.size()+generated.size());
+    std::merge(ops.constBegin(), ops.constEnd(),
+               generated.constBegin(), generated.constEnd(),
+               std::back_inserter(merged), op_cmp);
+    return merged;
 }
 
-void OperationCollection::aggregate(const Operation *op)
+void OperationCollection::aggregate(const Operation *op, const QDate &date)
 {
     Amount amount=op->amount();
     /* balance, total credit and total debit */
@@ -73,22 +222,10 @@ void OperationCollection::aggregate(const Operation *op)
         m_total_credit+=amount;
     }
     /* add op month to months set */
-    m_years.insert(op->date().year());
-    m_months.insert(op->date().month());
-    QHash<QString, Amount>::iterator it;
-    /* total expense per budget */
-    it=m_expense_per_budget.find(op->budget());
-    if(it!=m_expense_per_budget.end()) {
-        it.value()+=amount;
-    } else {
-        m_expense_per_budget.insert(op->budget(), amount);
-    }
-    /* total expense per payment method */
-    it=m_expense_per_pm.find(op->payment_method());
-    if(it!=m_expense_per_pm.end()) {
-        it.value()+=amount;
-    } else {
-        m_expense_per_pm.insert(op->payment_method(), amount);
-    }
+    m_years.insert(date.year());
+    m_months.insert(date.month());
+    /* total expense per budget and per payment method */
+    accumulate(m_expense_per_budget, m_budget_seen, op->budget_symbol(), amount);
+    accumulate(m_expense_per_pm, m_pm_seen, op->payment_method_symbol(), amount);
 }
 
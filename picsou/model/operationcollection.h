@@ -20,32 +20,76 @@
 
 #include <QList>
 #include <QHash>
+#include <QVector>
 #include <QString>
+#include <QBitArray>
 
 #include "object/operation.h"
+#include "object/scheduledoperation.h"
+#include "rollup.h"
+
+/* read-only view of a recorded operation or of an occurrence of a scheduled
+   operation, in which case op holds the fields of the scheduled operation */
+struct OperationView
+{
+    OperationView(const Operation *op=nullptr,
+                  const QDate &date=QDate(),
+                  bool scheduled=false,
+                  const Account *account=nullptr) :
+        op(op),
+        date(date),
+        scheduled(scheduled),
+        account(account)
+    {
+
+    }
+
+    const Operation *op;
+    QDate date;
+    bool scheduled;
+    /* account the operation belongs to, results may span several accounts */
+    const Account *account;
+};
 
 class OperationCollection
 {
 public:
+    /* scheduled operations are not instanciated for each date they occur */
+    struct Occurrence
+    {
+        ScheduledOperationShPtr sop;
+        QDate date;
+    };
+
     OperationCollection(const Amount &initial_value=0.);
     OperationCollection(const OperationShPtrList &ops, const Amount &initial_value=0.);
 
     void clear();
     void append(const OperationShPtr &op);
+    void append(const ScheduledOperationShPtr &sop, const QDate &date);
+    void append(const OperationCollection &other);
+    /* stores without aggregating, totals are then read from a rollup */
+    void store(const OperationShPtr &op);
+    void store(const ScheduledOperationShPtr &sop, const QDate &date);
+    void aggregate(const Rollup &rollup, const QDate &from, const QDate &to, int month=-1);
 
-    inline int length() const { return list(false).length(); }
+    inline int length() const { return m_ops.length()+m_occurrences.size(); }
+    inline bool sorted() const { return m_sorted&&m_occurrences_sorted; }
     inline int year_cnt() const { return m_years.size(); }
     inline int month_cnt() const { return m_months.size(); }
     inline Amount balance() const { return m_balance+m_initial_value; }
     inline Amount total_debit() const { return m_total_debit; }
     inline Amount total_credit() const { return m_total_credit; }
-    inline QHash<QString, Amount> expense_per_pm() const { return m_expense_per_pm; }
-    inline QHash<QString, Amount> expense_per_budget() const { return m_expense_per_budget; }
+    QHash<QString, Amount> expense_per_pm() const;
+    QHash<QString, Amount> expense_per_budget() const;
 
+    inline OperationShPtrList recorded() const { return m_ops; }
+    inline QVector<Occurrence> occurrences() const { return m_occurrences; }
+    QVector<OperationView> views(bool sorted=true) const;
     OperationShPtrList list(bool sorted=true) const;
 
 protected:
-    void aggregate(const Operation *op);
+    void aggregate(const Operation *op, const QDate &date);
 
 private:
     /* aggregation members */
@@ -55,11 +99,19 @@ private:
     Amount m_initial_value;
     QSet<int> m_years;
     QSet<int> m_months;
-    QHash<QString, Amount> m_expense_per_pm;
-    QHash<QString, Amount> m_expense_per_budget;
+    /* indexed by payment method and budget symbols */
+    QVector<Amount> m_expense_per_pm;
+    QVector<Amount> m_expense_per_budget;
+    QBitArray m_pm_seen;
+    QBitArray m_budget_seen;
     /* pointer storage members */
     OperationShPtrList m_ops;
+    bool m_sorted;
+    QVector<Occurrence> m_occurrences;
+    bool m_occurrences_sorted;
 
 };
 
+bool op_cmp(const OperationShPtr &a, const OperationShPtr &b);
+
 #endif // OPERATIONCOLLECTION_H
@@ -21,6 +21,7 @@
 
 #include <QJsonDocument>
 
+const QString PicsouDBO::KW_ID="id";
 const QString PicsouDBO::KW_WDAT="data";
 const QString PicsouDBO::KW_WKEY="key";
 const QString PicsouDBO::KW_WSALT="salt";
@@ -30,8 +31,9 @@ PicsouDBO::PicsouDBO(bool valid, PicsouDBO *parent) :
     m_valid(valid),
     m_parent(parent)
 {
+    /* modifications are reported to ancestors through track_modified() */
+    connect(this, &PicsouDBO::modified, this, &PicsouDBO::self_modified);
     if(parent!=nullptr) {
-        connect(this, &PicsouDBO::modified, parent, &PicsouDBO::modified);
         connect(this, &PicsouDBO::unwrapped, parent, &PicsouDBO::unwrapped);
     }
 }
@@ -50,24 +52,64 @@ bool PicsouDBO::write_unwrapped(QJsonObject &) const
     LOG_BOOL_RETURN(false)
 }
 
-bool PicsouDBO::unwrap(const QString &pswd)
+bool PicsouDBO::read_unwrapped(const QByteArray &data)
 {
-    LOG_IN("pswd")
-    QByteArray data;
-    if(!m_wctx.unwrap(pswd, m_wdat, data)) {
-        LOG_CRITICAL("CryptoCtx::unwrap() operation failed.")
-        LOG_BOOL_RETURN(false)
-    }
+    LOG_IN("data.size="<<data.size())
     QJsonParseError err;
     QJsonDocument doc=QJsonDocument::fromJson(data, &err);
     if(doc.isNull()) {
         LOG_CRITICAL("failed to parse JSON: "<<err.errorString())
         LOG_BOOL_RETURN(false)
     }
-    if(!read_unwrapped(doc.object())) {
+    LOG_BOOL_RETURN(read_unwrapped(doc.object()))
+}
+
+bool PicsouDBO::write_unwrapped(QByteArray &data) const
+{
+    LOG_IN("<QByteArray>")
+    QJsonObject json;
+    if(!write_unwrapped(json)) {
+        LOG_BOOL_RETURN(false)
+    }
+    data=QJsonDocument(json).toJson(QJsonDocument::Compact);
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouDBO::unwrap(const QString &pswd)
+{
+    LOG_IN("pswd")
+    LOG_BOOL_RETURN(publish(decrypt(pswd)))
+}
+
+PicsouDBO::Decrypted PicsouDBO::decrypt(const QString &pswd) const
+{
+    LOG_IN("pswd")
+    /* key derivation and decryption only read wrapped data, this may run on any thread */
+    Decrypted decrypted;
+    if(!wrapped()) {
+        LOG_CRITICAL("object has been unwrapped already.")
+    } else if(!m_wctx.unwrap(pswd, m_wdat, decrypted.dpk, decrypted.data)) {
+        LOG_CRITICAL("CryptoCtx::unwrap() operation failed.")
+    } else {
+        decrypted.success=true;
+    }
+    LOG_DEBUG("-> success="<<decrypted.success)
+    return decrypted;
+}
+
+bool PicsouDBO::publish(const Decrypted &decrypted)
+{
+    LOG_IN("decrypted.success="<<decrypted.success)
+    /* objects are built on the thread owning this object */
+    if(!decrypted.success||!m_wctx.cache_dpk(decrypted.dpk)) {
+        LOG_BOOL_RETURN(false)
+    }
+    if(!read_unwrapped(decrypted.data)) {
         LOG_CRITICAL("read_unwrapped() operation failed.")
         LOG_BOOL_RETURN(false)
     }
+    /* wrapped data will be regenerated from objects on next write */
+    m_wdat.clear();
     emit unwrapped();
     LOG_BOOL_RETURN(true)
 }
@@ -92,6 +134,57 @@ bool PicsouDBO::rewrap(const QString &prev_pswd, const QString &next_pswd)
     LOG_BOOL_RETURN(true)
 }
 
+bool PicsouDBO::wrap_data(const QByteArray &cdata, QString &wdata) const
+{
+    LOG_IN("cdata,wdata")
+    if(!m_wctx.dpk_cached()&&m_parent!=nullptr) {
+        /* objects without their own key use the closest unwrapped ancestor's one */
+        LOG_BOOL_RETURN(m_parent->wrap_data(cdata, wdata))
+    }
+    LOG_BOOL_RETURN(m_wctx.wrap(cdata, wdata))
+}
+
+bool PicsouDBO::defer_data(const QByteArray &cdata, Deferred &deferred) const
+{
+    LOG_IN("cdata,<Deferred>")
+    if(!m_wctx.dpk_cached()&&m_parent!=nullptr) {
+        LOG_BOOL_RETURN(m_parent->defer_data(cdata, deferred))
+    }
+    if(!m_wctx.dpk_cached()) {
+        LOG_BOOL_RETURN(false)
+    }
+    deferred.ctx=m_wctx;
+    deferred.cdata=cdata;
+    LOG_BOOL_RETURN(true)
+}
+
+bool PicsouDBO::Deferred::wrap(QString &wdata) const
+{
+    LOG_IN("wdata")
+    LOG_BOOL_RETURN(ctx.wrap(cdata, wdata))
+}
+
+bool PicsouDBO::unwrap_data(const QString &wdata, QByteArray &cdata) const
+{
+    LOG_IN("wdata,cdata")
+    if(!m_wctx.dpk_cached()&&m_parent!=nullptr) {
+        LOG_BOOL_RETURN(m_parent->unwrap_data(wdata, cdata))
+    }
+    LOG_BOOL_RETURN(m_wctx.unwrap(wdata, cdata))
+}
+
+void PicsouDBO::track_modified(PicsouDBO *dbo)
+{
+    if(m_parent!=nullptr) {
+        m_parent->track_modified(dbo);
+    }
+}
+
+void PicsouDBO::self_modified()
+{
+    track_modified(this);
+}
+
 bool PicsouDBO::read_wrapped(const QJsonObject &json)
 {
     LOG_IN("json")
@@ -104,27 +197,23 @@ bool PicsouDBO::read_wrapped(const QJsonObject &json)
     LOG_BOOL_RETURN(wrapped())
 }
 
-bool PicsouDBO::write_wrapped(QJsonObject &json) const
+bool PicsouDBO::write_wrapped(QJsonObject &json, Deferred &deferred) const
 {
-    LOG_IN("json")
-    QString wrapped_data;
+    LOG_IN("json,<Deferred>")
     if(wrapped()) {
         /* underlying object has not been unwrapped => keep previous data */
-        wrapped_data=m_wdat;
+        json[KW_WDAT]=m_wdat;
     } else {
-        /* underlying object has been unwrapped and might have been modified => update data */
-        QJsonObject wjson;
-        if(!write_unwrapped(wjson)) {
+        /* underlying object has been unwrapped and might have been modified => update data,
+           it is wrapped later by the caller */
+        QByteArray wdat;
+        if(!write_unwrapped(wdat)) {
             LOG_CRITICAL("write_unwrapped() operation failed.")
             LOG_BOOL_RETURN(false)
         }
-        QJsonDocument wdoc(wjson);
-        if(!m_wctx.wrap(wdoc.toJson(QJsonDocument::Compact), wrapped_data)) {
-            LOG_CRITICAL("CryptoCtx::wrap() operation failed.")
-            LOG_BOOL_RETURN(false)
-        }
+        deferred.ctx=m_wctx;
+        deferred.cdata=wdat;
     }
-    json[KW_WDAT]=wrapped_data;
     json[KW_WKEY]=m_wctx.wkey();
     json[KW_WSALT]=m_wctx.wsalt();
     LOG_BOOL_RETURN(true)
@@ -30,6 +30,25 @@ class PicsouDBO : public QObject
 {
     Q_OBJECT
 public:
+    /* output of the thread-safe step of unwrap() */
+    struct Decrypted
+    {
+        bool success=false;
+        CryptoBuf dpk;
+        QByteArray data;
+    };
+
+    /* plaintext waiting to be wrapped with a copy of the key, this may run on any thread */
+    struct Deferred
+    {
+        CryptoCtx ctx;
+        QByteArray cdata;
+
+        inline bool pending() const { return !cdata.isNull(); }
+        bool wrap(QString &wdata) const;
+    };
+
+    static const QString KW_ID;
     static const QString KW_WDAT;
     static const QString KW_WKEY;
     static const QString KW_WSALT;
@@ -41,14 +60,21 @@ public:
     inline bool valid() const { return m_valid; }
     inline bool wrapped() const { return !m_wctx.dpk_cached(); }
 
+    inline PicsouDBO *parent_dbo() const { return m_parent; }
+
+    inline void set_id(QUuid id) { m_id=id; }
     inline void set_parent(PicsouDBO *parent) { m_parent=parent; }
 
     virtual bool read(const QJsonObject &json)=0;
     virtual bool write(QJsonObject &json) const=0;
     virtual bool read_unwrapped(const QJsonObject &json);
     virtual bool write_unwrapped(QJsonObject &json) const;
+    virtual bool read_unwrapped(const QByteArray &data);
+    virtual bool write_unwrapped(QByteArray &data) const;
 
     bool unwrap(const QString &pswd);
+    Decrypted decrypt(const QString &pswd) const;
+    bool publish(const Decrypted &decrypted);
     void init_wkey(const QString &pswd);
 
 signals:
@@ -58,9 +84,18 @@ signals:
 protected:
     inline void set_valid(bool valid=true) { m_valid=valid; }
 
+    /* called with the object which emitted modified(), forwards it to parent by default */
+    virtual void track_modified(PicsouDBO *dbo);
+
     bool rewrap(const QString &prev_pswd, const QString &next_pswd);
     bool read_wrapped(const QJsonObject &json);
-    bool write_wrapped(QJsonObject &json) const;
+    bool write_wrapped(QJsonObject &json, Deferred &deferred) const;
+    bool wrap_data(const QByteArray &cdata, QString &wdata) const;
+    bool defer_data(const QByteArray &cdata, Deferred &deferred) const;
+    bool unwrap_data(const QString &wdata, QByteArray &cdata) const;
+
+private slots:
+    void self_modified();
 
 private:
     QUuid m_id;
@@ -92,6 +127,9 @@ private:
                 set_valid(false); \
                 LOG_BOOL_RETURN(false) \
             } \
+            if(array__[i__].toObject().contains(PicsouDBO::KW_ID)) { \
+                obj__->set_id(QUuid(array__[i__].toObject()[PicsouDBO::KW_ID].toString())); \
+            } \
             (member).insert(obj__->id(), QSharedPointer<Class>(obj__)); \
         } \
     } while(0)
@@ -106,6 +144,7 @@ private:
                 /* TRACE */ \
                 LOG_BOOL_RETURN(false) \
             } \
+            obj__[PicsouDBO::KW_ID]=(list)[i__]->id().toString(); \
             array__.append(obj__); \
         } \
         (json)[(name)]=array__; \
@@ -0,0 +1,104 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "rollup.h"
+#include "object/operation.h"
+
+void Rollup::clear()
+{
+    m_months.clear();
+    m_contributions.clear();
+}
+
+void Rollup::add(const Operation &op, const QDate &date)
+{
+    accumulate(contribution(op, date), 1);
+}
+
+void Rollup::insert(const Operation *op)
+{
+    Contribution added=contribution(*op, op->date());
+    remove(op);
+    accumulate(added, 1);
+    m_contributions.insert(op->id(), added);
+}
+
+void Rollup::remove(const Operation *op)
+{
+    QHash<QUuid, Contribution>::iterator it=m_contributions.find(op->id());
+    if(it==m_contributions.end()) {
+        return;
+    }
+    accumulate(*it, -1);
+    m_contributions.erase(it);
+}
+
+void Rollup::range(const QDate &from,
+                   const QDate &to,
+                   Months::const_iterator &first,
+                   Months::const_iterator &last) const
+{
+    first=m_months.constBegin();
+    last=m_months.constEnd();
+    if(from.isValid()&&to.isValid()&&to<from) {
+        first=last;
+        return;
+    }
+    if(from.isValid()) {
+        first=m_months.lowerBound(month_key(from.year(), from.month()));
+    }
+    if(to.isValid()) {
+        last=m_months.upperBound(month_key(to.year(), to.month()));
+    }
+}
+
+Rollup::Contribution Rollup::contribution(const Operation &op, const QDate &date)
+{
+    Contribution contribution;
+    contribution.key=month_key(date.year(), date.month());
+    contribution.symbols=qMakePair(op.budget_symbol(), op.payment_method_symbol());
+    contribution.amount=op.amount().minor_units();
+    contribution.debit=(op.type()==Operation::DEBIT);
+    return contribution;
+}
+
+void Rollup::accumulate(const Contribution &contribution, int sign)
+{
+    Months::iterator month=m_months.find(contribution.key);
+    if(month==m_months.end()) {
+        month=m_months.insert(contribution.key, MonthCells());
+    }
+    MonthCells::iterator it=month->find(contribution.symbols);
+    if(it==month->end()) {
+        it=month->insert(contribution.symbols, Cell());
+    }
+    qint64 amount=sign*contribution.amount;
+    it->total+=amount;
+    if(contribution.debit) {
+        it->debit+=amount;
+    } else {
+        it->credit+=amount;
+    }
+    it->count+=sign;
+    /* empty cells and months are dropped, periods only count months with operations */
+    if(it->count==0) {
+        month->erase(it);
+        if(month->isEmpty()) {
+            m_months.erase(month);
+        }
+    }
+}
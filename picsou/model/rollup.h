@@ -0,0 +1,89 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <QMap>
+#include <QHash>
+#include <QPair>
+#include <QUuid>
+#include <QDate>
+
+class Operation;
+
+/* sums and counts of operations per month, budget and payment method, kept
+   up to date on every change so that statistics of a period are read from
+   a few cells instead of every operation */
+class Rollup
+{
+public:
+    struct Cell
+    {
+        Cell() :
+            total(0),
+            debit(0),
+            credit(0),
+            count(0)
+        {
+
+        }
+
+        /* amounts in minor units */
+        qint64 total;
+        qint64 debit;
+        qint64 credit;
+        int count;
+    };
+    /* cells of a month keyed by budget and payment method symbols */
+    typedef QHash<QPair<int, int>, Cell> MonthCells;
+    typedef QMap<int, MonthCells> Months;
+
+    static inline int month_key(int year, int month) { return year*12+month-1; }
+
+    void clear();
+    /* anonymous contribution, scheduled occurrences are never removed one by one */
+    void add(const Operation &op, const QDate &date);
+    void insert(const Operation *op);
+    void remove(const Operation *op);
+
+    inline const Months &months() const { return m_months; }
+    /* months spanned by the dates, invalid bounds leave the range open */
+    void range(const QDate &from,
+               const QDate &to,
+               Months::const_iterator &first,
+               Months::const_iterator &last) const;
+
+private:
+    struct Contribution
+    {
+        int key;
+        QPair<int, int> symbols;
+        qint64 amount;
+        bool debit;
+    };
+
+    static Contribution contribution(const Operation &op, const QDate &date);
+    void accumulate(const Contribution &contribution, int sign);
+
+private:
+    Months m_months;
+    /* operations may change before removal */
+    QHash<QUuid, Contribution> m_contributions;
+};
+
+#endif // ROLLUP_H
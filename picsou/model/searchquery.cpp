@@ -18,6 +18,69 @@
 #include "searchquery.h"
 #include "utils/macro.h"
 
+static QBitArray symbols(const SymbolTable &table, const QStringList &strs)
+{
+    QBitArray symbols(table.count());
+    for(const auto &str : strs) {
+        int symbol=table.find(str);
+        if(symbol!=SymbolTable::INVALID_SYMBOL&&symbol<symbols.size()) {
+            symbols.setBit(symbol);
+        }
+    }
+    return symbols;
+}
+
+static bool accepted(const QBitArray &symbols, int symbol)
+{
+    return symbol<symbols.size()&&symbols.testBit(symbol);
+}
+
+SearchQuery::Pattern::Pattern(const QString &filter) :
+    m_kind(ANY)
+{
+    static const QString metachars="\\^$.|?+()[]{}";
+    /* leading and trailing wildcards do not change the outcome of an unanchored match */
+    int first=0, last=filter.length()-1;
+    while(first<=last&&filter.at(first)=='*') {
+        first++;
+    }
+    while(last>=first&&filter.at(last)=='*') {
+        last--;
+    }
+    m_needle=filter.mid(first, last-first+1);
+    if(m_needle.isEmpty()) {
+        m_kind=ANY;
+        return;
+    }
+    for(const auto &c : m_needle) {
+        if(c=='*'||metachars.contains(c)) {
+            m_kind=REGEX;
+            break;
+        }
+    }
+    if(m_kind!=REGEX) {
+        m_kind=SUBSTRING;
+        return;
+    }
+    QString pattern=filter;
+    m_re=QRegularExpression(pattern.replace("*", "\\w*"),
+                            QRegularExpression::CaseInsensitiveOption);
+    m_re.optimize();
+}
+
+bool SearchQuery::Pattern::matches(const QString &str) const
+{
+    switch (m_kind) {
+    case ANY:
+        return true;
+    case SUBSTRING:
+        return str.contains(m_needle, Qt::CaseInsensitive);
+    case REGEX:
+        return m_re.match(str).hasMatch();
+    }
+    return false;
+}
+
 SearchQuery::SearchQuery(const QString &username,
                          const QString &account_name,
                          const QDate &from,
@@ -27,15 +90,20 @@ SearchQuery::SearchQuery(const QString &username,
                          const QString &description_filter,
                          const QString &srcdst_filter,
                          const QStringList &budgets,
-                         const QStringList &pms) :
+                         const QStringList &pms,
+                         bool all_accounts) :
     m_username(username),
     m_account_name(account_name),
     m_from(from),
     m_to(to),
     m_min(min),
     m_max(max),
+    m_description_filter(description_filter),
+    m_description(description_filter),
+    m_srcdst(srcdst_filter),
     m_budgets(budgets),
-    m_pms(pms)
+    m_pms(pms),
+    m_all_accounts(all_accounts)
 {
     LOG_IN("username="<<username
            <<",account_name="<<account_name
@@ -46,50 +114,39 @@ SearchQuery::SearchQuery(const QString &username,
            <<",description_filter="<<description_filter
            <<",recipient_filter="<<srcdst_filter
            <<",budgets="<<budgets
-           <<",pms="<<pms)
-    QString description_re=description_filter.isEmpty()?"*":description_filter;
-    QString recipient_re=srcdst_filter.isEmpty()?"*":srcdst_filter;
+           <<",pms="<<pms
+           <<",all_accounts="<<all_accounts)
     m_budgets.append("");
-    m_description_re=QRegularExpression(description_re.replace("*", "\\w*"),
-                                        QRegularExpression::CaseInsensitiveOption);
-    m_srcdst_re=QRegularExpression(recipient_re.replace("*", "\\w*"),
-                                      QRegularExpression::CaseInsensitiveOption);
-    m_description_re.optimize();
-    m_srcdst_re.optimize();
+    m_budget_symbols=symbols(Operation::BUDGETS, m_budgets);
+    m_pm_symbols=symbols(Operation::PAYMENT_METHODS, m_pms);
     LOG_VOID_RETURN()
 }
 
 bool SearchQuery::accepts(const OperationShPtr &op) const
 {
-    LOG_IN("op="<<op)
-    QDate date=op->date();
-    Amount amount=qAbs(op->amount());
-    QString srcdst=op->srcdst();
-    QString description=op->description();
+    return accepts(*op, op->date());
+}
+
+bool SearchQuery::accepts(const Operation &op, const QDate &date) const
+{
+    /* runs for every operation: cheapest clauses first and no logging */
     if(date<m_from||date>m_to) {
-        LOG_DEBUG("rejecting "<<op<<" because "<<date<<"<"<<m_from<<"||"<<date<<">"<<m_to)
-        LOG_BOOL_RETURN(false)
+        return false;
     }
+    Amount amount=qAbs(op.amount());
     if(amount<m_min||amount>m_max) {
-        LOG_DEBUG("rejecting "<<op<<" because "<<amount.value()<<"<"<<m_min.value()<<"||"<<amount.value()<<">"<<m_max.value())
-        LOG_BOOL_RETURN(false)
-    }
-    if(!m_budgets.contains(op->budget())) {
-        LOG_DEBUG("rejecting "<<op<<" because "<<op->budget()<<" not in "<<m_budgets)
-        LOG_BOOL_RETURN(false)
+        return false;
     }
-    if(!m_pms.contains(op->payment_method())) {
-        LOG_DEBUG("rejecting "<<op<<" because "<<op->payment_method()<<" not in "<<m_pms)
-        LOG_BOOL_RETURN(false)
+    if(!accepted(m_budget_symbols, op.budget_symbol())) {
+        return false;
     }
-    if(!srcdst.isEmpty()&&!m_srcdst_re.match(srcdst).hasMatch()) {
-        LOG_DEBUG("rejecting "<<op<<" because \""<<srcdst<<"\" is not matched by "<<m_srcdst_re.pattern())
-        LOG_BOOL_RETURN(false)
+    if(!accepted(m_pm_symbols, op.payment_method_symbol())) {
+        return false;
     }
-    if(!description.isEmpty()&&!m_description_re.match(description).hasMatch()) {
-        LOG_DEBUG("rejecting "<<op<<" because \""<<description<<"\" is not matched by "<<m_description_re.pattern())
-        LOG_BOOL_RETURN(false)
+    const QString &srcdst=op.srcdst();
+    if(!srcdst.isEmpty()&&!m_srcdst.matches(srcdst)) {
+        return false;
     }
-    LOG_DEBUG("accepting "<<op)
-    LOG_BOOL_RETURN(true)
+    const QString &description=op.description();
+    return description.isEmpty()||m_description.matches(description);
 }
@@ -19,9 +19,11 @@
 #define SEARCHQUERY_H
 
 #include <QDate>
+#include <QBitArray>
 #include <QRegularExpression>
 #include "utils/amount.h"
 #include "object/operation.h"
+#include "operationcollection.h"
 
 class SearchQuery
 {
@@ -33,12 +35,42 @@ public:
                 const QString &description_filter,
                 const QString &srcdst_filter,
                 const QStringList &budgets,
-                const QStringList &pms);
+                const QStringList &pms,
+                bool all_accounts=false);
 
     bool accepts(const OperationShPtr &op) const;
+    bool accepts(const Operation &op, const QDate &date) const;
 
     inline QString username() const { return m_username; }
     inline QString account_name() const { return m_account_name; }
+    inline QDate from() const { return m_from; }
+    inline QDate to() const { return m_to; }
+    inline Amount min() const { return m_min; }
+    inline Amount max() const { return m_max; }
+    inline QString description_filter() const { return m_description_filter; }
+    /* search every account of every unlocked user, names of budgets and payment methods are shared */
+    inline bool all_accounts() const { return m_all_accounts; }
+
+private:
+    /* wildcard filter compiled to the cheapest equivalent test */
+    class Pattern
+    {
+    public:
+        Pattern(const QString &filter=QString());
+
+        bool matches(const QString &str) const;
+
+    private:
+        enum Kind {
+            ANY,
+            SUBSTRING,
+            REGEX
+        };
+
+        Kind m_kind;
+        QString m_needle;
+        QRegularExpression m_re;
+    };
 
 private:
     QString m_username;
@@ -47,25 +79,48 @@ private:
     QDate m_to;
     Amount m_min;
     Amount m_max;
-    QRegularExpression m_description_re;
-    QRegularExpression m_srcdst_re;
+    QString m_description_filter;
+    Pattern m_description;
+    Pattern m_srcdst;
     QStringList m_budgets;
     QStringList m_pms;
+    bool m_all_accounts;
+    /* accepted symbols */
+    QBitArray m_budget_symbols;
+    QBitArray m_pm_symbols;
+};
+
+/* share of an account searched by a single worker */
+struct SearchChunk
+{
+    OperationShPtrList ops;
+    QVector<OperationCollection::Occurrence> occurrences;
 };
 
-struct SearchQueryFilter
+struct SearchQueryMapper
 {
-    SearchQueryFilter(const SearchQuery &query) :
+    SearchQueryMapper(const SearchQuery &query) :
         m_query(query)
     {
 
     }
 
-    typedef bool result_type;
+    typedef OperationCollection result_type;
 
-    bool operator()(const OperationShPtr &op)
+    OperationCollection operator()(const SearchChunk &chunk)
     {
-        return m_query.accepts(op);
+        OperationCollection matches;
+        for(const auto &op : chunk.ops) {
+            if(m_query.accepts(op)) {
+                matches.append(op);
+            }
+        }
+        for(const auto &occurrence : chunk.occurrences) {
+            if(m_query.accepts(occurrence.sop->prototype(), occurrence.date)) {
+                matches.append(occurrence.sop, occurrence.date);
+            }
+        }
+        return matches;
     }
 
     SearchQuery m_query;
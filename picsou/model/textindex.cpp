@@ -0,0 +1,185 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "textindex.h"
+#include "object/operation.h"
+
+#include <algorithm>
+
+static bool is_word_char(const QChar &c)
+{
+    return c.isLetterOrNumber()||c=='_';
+}
+
+QStringList TextIndex::words(const QString &text)
+{
+    QStringList words;
+    int start=-1;
+    for(int i=0; i<=text.length(); ++i) {
+        if(i<text.length()&&is_word_char(text.at(i))) {
+            if(start<0) {
+                start=i;
+            }
+        } else if(start>=0) {
+            words.append(text.mid(start, i-start).toLower());
+            start=-1;
+        }
+    }
+    words.removeDuplicates();
+    return words;
+}
+
+TextIndex::TextIndex() :
+    m_suffixes_valid(false)
+{
+
+}
+
+void TextIndex::clear()
+{
+    m_postings.clear();
+    m_words.clear();
+    m_suffixes_valid=false;
+}
+
+void TextIndex::insert(const Operation *op)
+{
+    QStringList op_words=words(op->description());
+    if(op->description().isEmpty()) {
+        op_words.append(QString(""));
+    }
+    for(const auto &word : op_words) {
+        QHash<QString, QSet<QUuid> >::iterator posting=m_postings.find(word);
+        if(posting==m_postings.end()) {
+            posting=m_postings.insert(word, QSet<QUuid>());
+            m_suffixes_valid=false;
+        }
+        posting->insert(op->id());
+    }
+    m_words.insert(op->id(), op_words);
+}
+
+void TextIndex::remove(const Operation *op)
+{
+    QHash<QUuid, QStringList>::iterator it=m_words.find(op->id());
+    if(it==m_words.end()) {
+        return;
+    }
+    for(const auto &word : *it) {
+        QHash<QString, QSet<QUuid> >::iterator posting=m_postings.find(word);
+        if(posting==m_postings.end()) {
+            continue;
+        }
+        posting->remove(op->id());
+        if(posting->isEmpty()) {
+            m_postings.erase(posting);
+            m_suffixes_valid=false;
+        }
+    }
+    m_words.erase(it);
+}
+
+bool TextIndex::candidates(const QString &filter, QSet<QUuid> &ids) const
+{
+    static const QString metachars="\\^$.|?+()[]{}";
+    for(const auto &c : filter) {
+        if(metachars.contains(c)) {
+            /* regular expressions are not resolved by the index */
+            return false;
+        }
+    }
+    ensure_suffixes();
+    /* words of a matching description contain every literal piece of the
+       filter, wildcards only stand for word characters */
+    bool first=true;
+    int start=-1;
+    for(int i=0; i<=filter.length(); ++i) {
+        if(i<filter.length()&&is_word_char(filter.at(i))) {
+            if(start<0) {
+                start=i;
+            }
+            continue;
+        }
+        if(start<0) {
+            continue;
+        }
+        /* a piece next to any other separator than a wildcard starts or ends a word */
+        bool word_start=(start>0&&filter.at(start-1)!='*');
+        bool word_end=(i<filter.length()&&filter.at(i)!='*');
+        QSet<QUuid> matched;
+        lookup(filter.mid(start, i-start).toLower(), word_start, word_end, matched);
+        start=-1;
+        if(first) {
+            ids=matched;
+            first=false;
+        } else {
+            ids.intersect(matched);
+        }
+        if(ids.isEmpty()) {
+            break;
+        }
+    }
+    if(first) {
+        return false;
+    }
+    /* empty descriptions are accepted by any filter */
+    ids.unite(m_postings.value(QString("")));
+    return true;
+}
+
+void TextIndex::ensure_suffixes() const
+{
+    if(m_suffixes_valid) {
+        return;
+    }
+    m_sorted_words=m_postings.keys();
+    m_sorted_words.removeAll(QString(""));
+    m_sorted_words.sort();
+    m_suffixes.clear();
+    for(int w=0; w<m_sorted_words.size(); ++w) {
+        for(int offset=0; offset<m_sorted_words.at(w).length(); ++offset) {
+            m_suffixes.append(Suffix(w, offset));
+        }
+    }
+    const QStringList &words=m_sorted_words;
+    std::sort(m_suffixes.begin(), m_suffixes.end(), [&words](const Suffix &a, const Suffix &b) {
+        return words.at(a.first).midRef(a.second).compare(words.at(b.first).midRef(b.second))<0;
+    });
+    m_suffixes_valid=true;
+}
+
+void TextIndex::lookup(const QString &piece, bool word_start, bool word_end, QSet<QUuid> &ids) const
+{
+    const QStringList &words=m_sorted_words;
+    QVector<Suffix>::const_iterator it=std::lower_bound(m_suffixes.constBegin(),
+                                                        m_suffixes.constEnd(),
+                                                        piece,
+                                                        [&words](const Suffix &suffix, const QString &piece) {
+        return words.at(suffix.first).midRef(suffix.second).compare(piece)<0;
+    });
+    /* suffixes starting with the piece are contiguous */
+    for(; it!=m_suffixes.constEnd(); ++it) {
+        QStringRef suffix=words.at(it->first).midRef(it->second);
+        if(!suffix.startsWith(piece)) {
+            break;
+        }
+        if((word_start&&it->second!=0)||(word_end&&suffix.length()!=piece.length())) {
+            continue;
+        }
+        ids.unite(m_postings.value(words.at(it->first)));
+    }
+}
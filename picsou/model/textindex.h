@@ -0,0 +1,66 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QSet>
+#include <QHash>
+#include <QPair>
+#include <QUuid>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+class Operation;
+
+/* inverted index from the lower case words of operation descriptions to
+   operation identifiers, operations with an empty description are indexed
+   under an empty word */
+class TextIndex
+{
+public:
+    static QStringList words(const QString &text);
+
+    TextIndex();
+
+    void clear();
+    void insert(const Operation *op);
+    void remove(const Operation *op);
+
+    bool candidates(const QString &filter, QSet<QUuid> &ids) const;
+
+private:
+    /* index in m_sorted_words and offset of the suffix in that word */
+    typedef QPair<int, int> Suffix;
+
+    void ensure_suffixes() const;
+    void lookup(const QString &piece, bool word_start, bool word_end, QSet<QUuid> &ids) const;
+
+private:
+    QHash<QString, QSet<QUuid> > m_postings;
+    /* words indexed for each operation, descriptions may change before removal */
+    QHash<QUuid, QStringList> m_words;
+    /* every suffix of every word in lexicographic order so that a piece found
+       anywhere in a word is looked up by bisection, rebuilt when words appear
+       or disappear */
+    mutable QStringList m_sorted_words;
+    mutable QVector<Suffix> m_suffixes;
+    mutable bool m_suffixes_valid;
+};
+
+#endif // TEXTINDEX_H
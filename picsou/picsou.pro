@@ -68,6 +68,7 @@ SOURCES += \
     utils/amount.cpp \
     utils/schedule.cpp \
     utils/semver.cpp \
+    utils/symboltable.cpp \
     model/object/scheduledoperation.cpp \
     model/object/paymentmethod.cpp \
     model/object/operation.cpp \
@@ -81,6 +82,13 @@ SOURCES += \
     model/picsoudbo.cpp \
     model/converter/converter_100_110.cpp \
     model/converter/converter_110_200.cpp \
+    model/converter/converter_200_210.cpp \
+    model/converter/converter_210_220.cpp \
+    model/columnardocument.cpp \
+    model/changeset.cpp \
+    model/forecast.cpp \
+    model/textindex.cpp \
+    model/rollup.cpp \
     app/picsouapplication.cpp \
     app/picsoumodelservice.cpp \
     app/picsouuiservice.cpp \
@@ -129,11 +137,18 @@ HEADERS += \
     model/object/user.h \
     model/operationcollection.h \
     model/picsoudbo.h \
+    model/columnardocument.h \
+    model/changeset.h \
+    model/forecast.h \
+    model/textindex.h \
+    model/rollup.h \
+    model/nameindex.h \
     model/searchquery.h \
     utils/amount.h \
     utils/macro.h \
     utils/schedule.h \
     utils/semver.h \
+    utils/symboltable.h \
     app/picsouapplication.h \
     app/picsoumodelservice.h \
     app/picsouuiservice.h \
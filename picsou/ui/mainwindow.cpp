@@ -69,6 +69,8 @@ MainWindow::MainWindow(PicsouUIServicePtr ui_svc, QWidget *parent) :
     connect(ui->action_close, &QAction::triggered, ui_svc, &PicsouUIService::db_close);
     connect(ui->action_save, &QAction::triggered, ui_svc, &PicsouUIService::db_save);
     connect(ui->action_save_as, &QAction::triggered, ui_svc, &PicsouUIService::db_save_as);
+    connect(ui->action_compact, &QAction::triggered, ui_svc, &PicsouUIService::db_compact);
+    connect(ui->action_unlock_all, &QAction::triggered, ui_svc, &PicsouUIService::unlock_all);
     connect(ui->action_quit, &QAction::triggered, this, &MainWindow::close);
     /* settings menu */
     connect(ui->action_preferences, &QAction::triggered, ui_svc, &PicsouUIService::show_preferences);
@@ -83,6 +85,8 @@ MainWindow::MainWindow(PicsouUIServicePtr ui_svc, QWidget *parent) :
     /* search */
     connect(m_search_form, &SearchFilterForm::search_request, this, &MainWindow::update_search);
     connect(m_search_form, &SearchFilterForm::search_update_failed, this, &MainWindow::show_status);
+    connect(ui_svc, &PicsouUIService::search_results_ready, this, &MainWindow::append_search_results);
+    connect(ui_svc, &PicsouUIService::search_finished, this, &MainWindow::search_finished);
     /* signal handlers */
     connect(ui_svc, &PicsouUIService::db_opened, this, &MainWindow::db_opened);
     connect(ui_svc, &PicsouUIService::db_saved, this, &MainWindow::db_saved);
@@ -172,16 +176,38 @@ void MainWindow::update_viewer(QTreeWidgetItem *, int)
 void MainWindow::update_search()
 {
     LOG_IN_VOID()
-    m_search_table->clear();
-    OperationCollection ops=ui_svc()->search_operations(m_search_form->query());
-    if(ops.length()>0) {
-        BudgetShPtrList budgets=ui_svc()->user_budgets(m_search_form->query().username());
-        m_search_table->refresh(ops);
-        m_search_ops_stats->refresh(ops, budgets);
+    SearchQuery query=m_search_form->query();
+    m_search_table->set_account_column(query.all_accounts());
+    m_search_ops_stats->clear();
+    m_search_results=OperationCollection();
+    /* results of every unlocked user are compared with all their budgets */
+    m_search_budgets=(query.all_accounts()?
+                          ui_svc()->unlocked_budgets():
+                          ui_svc()->user_budgets(query.username()));
+    ui_svc()->search_operations(query);
+    LOG_VOID_RETURN()
+}
+
+void MainWindow::append_search_results(const OperationCollection &ops)
+{
+    m_search_results.append(ops);
+    m_search_table->append(ops);
+}
+
+void MainWindow::search_finished(bool canceled)
+{
+    LOG_IN("canceled="<<canceled)
+    if(m_search_results.length()>0) {
+        /* batches arrive in completion order, rows are sorted once at the end */
+        m_search_table->refresh(m_search_results);
+        m_search_ops_stats->refresh(m_search_results, m_search_budgets);
     } else {
         m_search_table->clear();
         m_search_ops_stats->clear();
     }
+    if(canceled) {
+        ui->statusbar->showMessage(tr("Search canceled, showing partial results."), TIMEOUT);
+    }
     LOG_VOID_RETURN()
 }
 
@@ -226,6 +252,8 @@ void MainWindow::refresh(MainWindow::State state)
         ui->action_open->setEnabled(true);
         ui->action_save->setEnabled(false);
         ui->action_save_as->setEnabled(false);
+        ui->action_compact->setEnabled(false);
+        ui->action_unlock_all->setEnabled(false);
         ui->action_close->setEnabled(false);
         /* update tree widget */
         ui->tree->clear();
@@ -238,6 +266,8 @@ void MainWindow::refresh(MainWindow::State state)
     case DB_OPENED:
         /* update menu actions */
         ui->action_save_as->setEnabled(true);
+        ui->action_compact->setEnabled(true);
+        ui->action_unlock_all->setEnabled(true);
         ui->action_close->setEnabled(true);
         /* update tree widget */
         refresh_tree();
@@ -63,7 +63,8 @@ private slots:
 
     void update_viewer(QTreeWidgetItem *, int);
     void update_search();
-
+    void append_search_results(const OperationCollection &ops);
+    void search_finished(bool canceled);
 
 protected:
     void p_update_viewer(QTreeWidgetItem *item, int column);
@@ -78,6 +79,8 @@ private:
     SearchFilterForm *m_search_form;
     OperationTableWidget *m_search_table;
     OperationStatistics *m_search_ops_stats;
+    OperationCollection m_search_results;
+    BudgetShPtrList m_search_budgets;
     Ui::MainWindow *ui;
 };
 
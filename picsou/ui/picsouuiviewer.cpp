@@ -30,3 +30,22 @@ PicsouUIViewer::PicsouUIViewer(PicsouUIServicePtr ui_svc,
 {
 
 }
+
+void PicsouUIViewer::model_updated(const PicsouDBShPtr db, const ChangeSet &changes)
+{
+    if(affected_by(db, changes)) {
+        refresh(db);
+    }
+}
+
+bool PicsouUIViewer::affected_by(const PicsouDBShPtr, const ChangeSet &changes) const
+{
+    /* changes list modified objects along with their ancestors */
+    return changes.contains(m_uuid);
+}
+
+bool PicsouUIViewer::budgets_changed(const PicsouDBShPtr, QUuid user_id, const ChangeSet &changes)
+{
+    /* removed budgets are no longer listed by the user, changes record their owner */
+    return changes.budgets_changed(user_id);
+}
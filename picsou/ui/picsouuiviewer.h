@@ -32,6 +32,7 @@ public:
 
 public slots:
     virtual void refresh(const PicsouDBShPtr db)=0;
+    void model_updated(const PicsouDBShPtr db, const ChangeSet &changes);
 
 protected:
     PicsouUIViewer(PicsouUIServicePtr ui_svc,
@@ -39,6 +40,9 @@ protected:
 
     inline QUuid mod_obj_id() const { return m_uuid; }
 
+    virtual bool affected_by(const PicsouDBShPtr db, const ChangeSet &changes) const;
+    static bool budgets_changed(const PicsouDBShPtr db, QUuid user_id, const ChangeSet &changes);
+
 private:
     QUuid m_uuid;
 };
@@ -42,7 +42,7 @@ AccountViewer::AccountViewer(PicsouUIServicePtr ui_svc,
     ui(new Ui::AccountViewer)
 {
     ui->setupUi(this);
-    connect(ui_svc, &PicsouUIService::notify_model_updated, this, &AccountViewer::refresh);
+    connect(ui_svc, &PicsouUIService::notify_model_updated, this, &PicsouUIViewer::model_updated);
 
     m_table=new OperationTableWidget;
     ui->ops_layout->insertWidget(0, m_table);
@@ -98,6 +98,34 @@ AccountViewer::AccountViewer(PicsouUIServicePtr ui_svc,
     addAction(ui->action_export_ops);
 }
 
+bool AccountViewer::affected_by(const PicsouDBShPtr db, const ChangeSet &changes) const
+{
+    /* statistics depend on the budgets of the user */
+    return PicsouUIViewer::affected_by(db, changes)||budgets_changed(db, m_user_id, changes);
+}
+
+void AccountViewer::set_stats_field(const QString &name, const QString &value)
+{
+    if(!m_ops_stats->update_field(name, value)) {
+        m_ops_stats->append_field(name, value);
+    }
+}
+
+void AccountViewer::refresh_forecast(const PicsouDBShPtr db)
+{
+    /* projected balances include scheduled operations after current date */
+    Forecast forecast=db->forecast(mod_obj_id());
+    QDate today=QDate::currentDate();
+    Amount projected;
+    set_stats_field(tr("Balance in a month:"),
+                    forecast.balance(today.addMonths(1), projected)?projected.to_str(true):tr("N/A"));
+    set_stats_field(tr("Balance in a year:"),
+                    forecast.balance(today.addYears(1), projected)?projected.to_str(true):tr("N/A"));
+    QDate overdraft=forecast.first_below(0);
+    set_stats_field(tr("Projected overdraft:"),
+                    overdraft.isValid()?overdraft.toString(Qt::ISODate):tr("None"));
+}
+
 void AccountViewer::refresh(const PicsouDBShPtr db)
 {
     OperationCollection ops;
@@ -145,6 +173,7 @@ void AccountViewer::refresh(const PicsouDBShPtr db)
         return;
     }
     m_ops_stats->refresh(ops, user->budgets());
+    refresh_forecast(db);
     bool has_ops=(ops.length()>0);
     /**/
     ui->op_add->setEnabled(!m_readonly);
@@ -41,6 +41,9 @@ public:
 public slots:
     void refresh(const PicsouDBShPtr db);
 
+protected:
+    bool affected_by(const PicsouDBShPtr db, const ChangeSet &changes) const;
+
 private slots:
     /* payment methods */
     void add_pm();
@@ -60,6 +63,10 @@ private slots:
     void table_edit_op(int row, int col);
     void table_update_op_verified(QUuid op_id, bool verified);
 
+private:
+    void refresh_forecast(const PicsouDBShPtr db);
+    void set_stats_field(const QString &name, const QString &value);
+
 private:
     bool m_readonly;
     QUuid m_user_id;
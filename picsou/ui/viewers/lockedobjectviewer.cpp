@@ -18,7 +18,7 @@ LockedObjectViewer::LockedObjectViewer(PicsouUIServicePtr ui_svc,
 
     ui->img_layout->insertWidget(ui->img_layout->indexOf(ui->img_rhs), svg);
 
-    connect(ui_svc, &PicsouUIService::notify_model_updated, this, &LockedObjectViewer::refresh);
+    connect(ui_svc, &PicsouUIService::notify_model_updated, this, &PicsouUIViewer::model_updated);
     connect(ui->unlock, &QPushButton::clicked, this, &LockedObjectViewer::unlock);
 }
 
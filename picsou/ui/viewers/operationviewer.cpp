@@ -45,7 +45,7 @@ OperationViewer::OperationViewer(PicsouUIServicePtr ui_svc,
     ui(new Ui::OperationViewer)
 {
     ui->setupUi(this);
-    connect(ui_svc, &PicsouUIService::notify_model_updated, this, &OperationViewer::refresh);
+    connect(ui_svc, &PicsouUIService::notify_model_updated, this, &PicsouUIViewer::model_updated);
 
     m_table=new OperationTableWidget;
     ui->main_layout->insertWidget(0, m_table);
@@ -69,6 +69,12 @@ OperationViewer::OperationViewer(PicsouUIServicePtr ui_svc,
     addAction(ui->action_remove_op);
 }
 
+bool OperationViewer::affected_by(const PicsouDBShPtr db, const ChangeSet &changes) const
+{
+    /* statistics depend on the budgets of the user */
+    return PicsouUIViewer::affected_by(db, changes)||budgets_changed(db, m_user_id, changes);
+}
+
 void OperationViewer::refresh(const PicsouDBShPtr db)
 {
     int year=-1, month=-1;
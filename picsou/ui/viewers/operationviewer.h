@@ -48,6 +48,9 @@ public:
 public slots:
     void refresh(const PicsouDBShPtr db);
 
+protected:
+    bool affected_by(const PicsouDBShPtr db, const ChangeSet &changes) const;
+
 private slots:
     /* ops */
     void add_op();
@@ -34,7 +34,7 @@ UserViewer::UserViewer(PicsouUIServicePtr ui_svc,
 {
     ui->setupUi(this);
 
-    connect(ui_svc, &PicsouUIService::notify_model_updated, this, &UserViewer::refresh);
+    connect(ui_svc, &PicsouUIService::notify_model_updated, this, &PicsouUIViewer::model_updated);
     /* budget editor */
     connect(ui->add_budget, &QPushButton::clicked, this, &UserViewer::add_budget);
     connect(ui->action_add_budget, &QAction::triggered, this, &UserViewer::add_budget);
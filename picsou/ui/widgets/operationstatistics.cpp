@@ -124,7 +124,8 @@ void OperationStatistics::refresh_expense_per_budget_table(const OperationCollec
     std::sort(sorted_epb.begin(), sorted_epb.end(), budget_amount_cmp);
     QHash<QString, Amount> budget_hash;
     for(const auto &budget : user_budgets) {
-        budget_hash.insert(budget->name(), budget->amount());
+        /* users may share budget names, their allowances add up */
+        budget_hash[budget->name()]+=budget->amount();
     }
     /* clear previous budget table */
     ui->expense_per_budget->clear();
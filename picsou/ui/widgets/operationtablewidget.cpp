@@ -18,6 +18,7 @@
 #include "utils/macro.h"
 #include "operationtablewidget.h"
 #include "ui/items/picsoutableitem.h"
+#include "model/object/account.h"
 #include <QHeaderView>
 
 OperationTableWidget::OperationTableWidget(QWidget *parent) :
@@ -43,23 +44,31 @@ void OperationTableWidget::clear()
                                              <<tr("Payment Method")
                                              <<tr("Budget")
                                              <<tr("Amount")
+                                             <<tr("Balance")
                                              <<tr("Verified");
 
+    QStringList column_labels=labels;
+    if(m_account_column) {
+        column_labels.insert(1, tr("Account"));
+    }
     QTableWidget::clear();
     verticalHeader()->hide();
     setRowCount(0);
-    setColumnCount(7);
-    setHorizontalHeaderLabels(labels);
-    horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
-    horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
-    horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
-    horizontalHeader()->setSectionResizeMode(4, QHeaderView::ResizeToContents);
-    horizontalHeader()->setSectionResizeMode(5, QHeaderView::ResizeToContents);
-    horizontalHeader()->setSectionResizeMode(6, QHeaderView::ResizeToContents);
+    setColumnCount(column_labels.length());
+    setHorizontalHeaderLabels(column_labels);
+    for(int c=0; c<column_labels.length(); ++c) {
+        horizontalHeader()->setSectionResizeMode(c, QHeaderView::ResizeToContents);
+    }
+    horizontalHeader()->setSectionResizeMode(m_account_column?2:1, QHeaderView::Stretch);
 }
 
 void OperationTableWidget::refresh(OperationCollection ops)
+{
+    clear();
+    append(ops);
+}
+
+void OperationTableWidget::append(const OperationCollection &ops)
 {
     static const int alpha=32;
     static const QIcon debit_icon=QIcon(":/resources/material-design/svg/trending-down.svg"),
@@ -69,16 +78,17 @@ void OperationTableWidget::refresh(OperationCollection ops)
     static const QColor debit_color=QColor(5, 5, 5, alpha),
                         credit_color=QColor(0, 255, 0, alpha);
 
-    clear();
-    setRowCount(ops.length());
+    int r=rowCount(), c;
+    setRowCount(r+ops.length());
 
-    int r=0, c;
     QIcon icon;
     QColor bgcolor;
     QList<QTableWidgetItem*> items;
-    OperationShPtrList ops_list=ops.list();
+    /* scheduled occurrences are displayed without being instanciated */
+    QVector<OperationView> views=ops.views();
     LOG_DEBUG("adding operations...")
-    for(const auto &op : ops_list) {
+    for(const auto &view : views) {
+        const Operation *op=view.op;
         LOG_DEBUG("adding op: "<<op)
         items.clear();
         switch (op->type()) {
@@ -96,16 +106,21 @@ void OperationTableWidget::refresh(OperationCollection ops)
             break;
         }
         items.append(new PicsouTableItem(icon,
-                                         op->date(),
+                                         view.date,
                                          op->id(),
-                                         op->scheduled()?PicsouTableItem::SCHEDULED:PicsouTableItem::NORMAL));
+                                         view.scheduled?PicsouTableItem::SCHEDULED:PicsouTableItem::NORMAL));
+        if(m_account_column) {
+            items.append(new QTableWidgetItem(view.account!=nullptr?view.account->name():QString()));
+        }
         items.append(new QTableWidgetItem(op->description()));
         items.append(new QTableWidgetItem(op->srcdst()));
         items.append(new QTableWidgetItem(op->payment_method()));
         items.append(new QTableWidgetItem(op->budget()));
         items.append(new QTableWidgetItem(op->amount().to_str(true)));
+        /* end of day balance of the account, looked up in its running totals */
+        items.append(new QTableWidgetItem(view.account!=nullptr?view.account->balance(view.date).to_str(true):QString()));
         QTableWidgetItem *checkbox=new QTableWidgetItem(PicsouTableItem::CHECKABLE);
-        if(op->scheduled()) {
+        if(view.scheduled) {
             checkbox->setIcon(scheduled_icon);
         } else {
             Qt::ItemFlags flags=Qt::ItemIsUserCheckable;
@@ -118,7 +133,7 @@ void OperationTableWidget::refresh(OperationCollection ops)
         items.append(checkbox);
         c=0;
         for(auto *item : items) {
-            item->setBackground(QBrush(bgcolor, op->scheduled()?Qt::Dense5Pattern:Qt::SolidPattern));
+            item->setBackground(QBrush(bgcolor, view.scheduled?Qt::Dense5Pattern:Qt::SolidPattern));
             setItem(r, c++, item);
         }
         r++;
@@ -30,10 +30,14 @@ public:
 
     void clear();
     void refresh(OperationCollection ops);
+    /* adds rows below the current ones, used to display results as they are found */
+    void append(const OperationCollection &ops);
     bool is_current_op_scheduled() const;
     QUuid current_op(QTableWidgetItem *item=nullptr) const;
 
     void set_readonly(bool ro) { m_readonly=ro; }
+    /* displays the account of each operation, for results spanning several accounts */
+    void set_account_column(bool enabled) { m_account_column=enabled; clear(); }
 
 signals:
     void op_edit_requested(int row, int col);
@@ -45,6 +49,7 @@ public slots:
 private:
     Q_DISABLE_COPY(OperationTableWidget)
     bool m_readonly=false;
+    bool m_account_column=false;
 };
 
 #endif // OPERATIONTABLEWIDGET_H
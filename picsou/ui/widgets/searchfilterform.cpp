@@ -47,6 +47,7 @@ SearchFilterForm::SearchFilterForm(PicsouUIServicePtr ui_svc, QWidget *parent) :
     connect(ui->user, &QComboBox::currentTextChanged, this, &SearchFilterForm::refresh_account_cb);
     connect(ui->user, &QComboBox::currentTextChanged, this, &SearchFilterForm::refresh_budgets_list);
     connect(ui->account, &QComboBox::currentTextChanged, this, &SearchFilterForm::refresh_pms_list);
+    connect(ui->all_accounts, &QCheckBox::toggled, this, &SearchFilterForm::toggle_all_accounts);
     connect(ui->min_amount, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
             this, &SearchFilterForm::limit_max_amount);
 }
@@ -69,7 +70,8 @@ SearchQuery SearchFilterForm::query() const
                        ui->description->text(),
                        ui->recipient->text(),
                        selected_budgets,
-                       selected_pms);
+                       selected_pms,
+                       ui->all_accounts->isChecked());
 }
 
 void SearchFilterForm::refresh_user_cb()
@@ -104,11 +106,14 @@ void SearchFilterForm::refresh_account_cb(const QString &username)
 void SearchFilterForm::refresh_budgets_list(const QString &username)
 {
     LOG_IN("username="<<username)
-    if(username.isEmpty()) {
+    bool all_accounts=ui->all_accounts->isChecked();
+    if(username.isEmpty()&&!all_accounts) {
         LOG_VOID_RETURN()
     }
     ui->budgets->clear();
-    if(!ui_svc()->populate_budgets_list(username, ui->budgets)) {
+    if(!(all_accounts?
+         ui_svc()->populate_all_budgets_list(ui->budgets):
+         ui_svc()->populate_budgets_list(username, ui->budgets))) {
         ui->budgets->clear();
         ui->search->setEnabled(false);
         LOG_CRITICAL("Failed to update budgets list.")
@@ -126,14 +131,27 @@ void SearchFilterForm::limit_max_amount(double minimum)
     ui->max_amount->setMinimum(minimum);
 }
 
+void SearchFilterForm::toggle_all_accounts(bool checked)
+{
+    /* lists offer the names used by every unlocked user when all accounts are searched */
+    ui->user->setEnabled(!checked);
+    ui->account->setEnabled(!checked);
+    refresh_budgets_list(ui->user->currentText());
+    refresh_pms_list(ui->account->currentText());
+    ui->search->setEnabled(ui->budgets->count()>0&&ui->pms->count()>0);
+}
+
 void SearchFilterForm::refresh_pms_list(const QString &account_name)
 {
     LOG_IN("account_name="<<account_name)
-    if(account_name.isEmpty()) {
+    bool all_accounts=ui->all_accounts->isChecked();
+    if(account_name.isEmpty()&&!all_accounts) {
         LOG_VOID_RETURN()
     }
     ui->pms->clear();
-    if(!ui_svc()->populate_pms_list(ui->user->currentText(), account_name, ui->pms)) {
+    if(!(all_accounts?
+         ui_svc()->populate_all_pms_list(ui->pms):
+         ui_svc()->populate_pms_list(ui->user->currentText(), account_name, ui->pms))) {
         ui->pms->clear();
         ui->search->setEnabled(false);
         LOG_CRITICAL("Failed to update payment methods list.")
@@ -49,6 +49,7 @@ public slots:
 
 private slots:
     void limit_max_amount(double minimum);
+    void toggle_all_accounts(bool checked);
 
 private:
     Ui::SearchFilterForm *ui;
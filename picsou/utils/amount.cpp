@@ -20,14 +20,17 @@
 
 #include <QObject>
 
+const int Amount::MINOR_DIGITS;
+const qint64 Amount::MINOR_UNITS;
+
 Amount::Amount(int value) :
-    m_value(value)
+    m_value(value*MINOR_UNITS)
 {
 
 }
 
 Amount::Amount(double value) :
-    m_value(value)
+    m_value(qRound64(value*MINOR_UNITS))
 {
 
 }
@@ -38,13 +41,62 @@ Amount::Amount(const Amount &other) :
 
 }
 
+Amount Amount::from_minor_units(qint64 minor_units)
+{
+    Amount amount;
+    amount.m_value=minor_units;
+    return amount;
+}
+
+Amount Amount::from_str(const QString &str, bool *ok)
+{
+    /* decimal string is parsed without going through a double */
+    QString s=str.trimmed();
+    bool negative=s.startsWith('-');
+    if(negative||s.startsWith('+')) {
+        s.remove(0, 1);
+    }
+    int sep=s.indexOf('.');
+    if(sep<0) {
+        sep=s.indexOf(',');
+    }
+    QString units=(sep<0?s:s.left(sep));
+    QString minor=(sep<0?QString():s.mid(sep+1));
+    bool valid=!(units.isEmpty()&&minor.isEmpty());
+    qint64 value=0;
+    for(const auto &c : units) {
+        valid=valid&&c.isDigit();
+        value=value*10+c.digitValue();
+    }
+    for(int i=0; i<MINOR_DIGITS; ++i) {
+        QChar c=(i<minor.length()?minor.at(i):QChar('0'));
+        valid=valid&&c.isDigit();
+        value=value*10+c.digitValue();
+    }
+    for(int i=MINOR_DIGITS; i<minor.length(); ++i) {
+        valid=valid&&minor.at(i).isDigit();
+    }
+    if(valid&&minor.length()>MINOR_DIGITS&&minor.at(MINOR_DIGITS).digitValue()>=5) {
+        /* extra digits are rounded half away from zero */
+        value++;
+    }
+    if(ok!=nullptr) {
+        *ok=valid;
+    }
+    return from_minor_units(valid?(negative?-value:value):0);
+}
+
 QString Amount::to_str(bool add_currency) const
 {
-    QString str;
+    QString str=QString::number(qAbs(m_value)/MINOR_UNITS);
+    if(MINOR_DIGITS>0) {
+        str+=QString(".%0").arg(qAbs(m_value)%MINOR_UNITS, MINOR_DIGITS, 10, QChar('0'));
+    }
+    if(m_value<0) {
+        str.prepend('-');
+    }
     if(add_currency) {
-        str=QObject::tr("$%0").arg(m_value, 0, 'f', 2);
-    } else {
-        str=QString("%0").arg(m_value, 0, 'f', 2);
+        str=QObject::tr("$%0").arg(str);
     }
     return str;
 }
@@ -55,8 +107,22 @@ Amount &Amount::operator=(const Amount &other)
     return *this;
 }
 
+Amount Amount::operator/(const Amount &other) const
+{
+    if(other.m_value==0) {
+        LOG_WARNING("division of an amount by zero.")
+        return Amount();
+    }
+    return from_minor_units(qRound64(static_cast<double>(m_value)*MINOR_UNITS/other.m_value));
+}
+
+Amount Amount::operator*(const Amount &other) const
+{
+    return from_minor_units(qRound64(static_cast<double>(m_value)*other.m_value/MINOR_UNITS));
+}
+
 QDebug operator<<(QDebug debug, const Amount &amount)
 {
-    debug<<"Amount("<<amount.value()<<")";
+    debug<<"Amount("<<amount.to_str()<<")";
     return debug;
 }
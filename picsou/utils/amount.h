@@ -20,43 +20,53 @@
 
 #include <QString>
 
+/* amounts are stored as an integer count of minor units so that additions
+   and comparisons are exact, multiplications and divisions are rounded half
+   away from zero to the nearest minor unit */
 class Amount
 {
 public:
+    static const int MINOR_DIGITS=2;
+    static const qint64 MINOR_UNITS=100; /* 10^MINOR_DIGITS */
+
     Amount(int value);
     Amount(double value=0);
     Amount(const Amount &other);
     Amount &operator=(const Amount &other);
 
+    static Amount from_minor_units(qint64 minor_units);
+    static Amount from_str(const QString &str, bool *ok=nullptr);
+
     inline bool debit() const { return m_value < 0; }
     inline bool credit() const { return m_value > 0; }
-    inline double value() const { return m_value; }
-    inline double absvalue() const { return qAbs(m_value); }
+    inline qint64 minor_units() const { return m_value; }
+    inline double value() const { return static_cast<double>(m_value)/MINOR_UNITS; }
+    inline double absvalue() const { return static_cast<double>(qAbs(m_value))/MINOR_UNITS; }
 
     QString to_str(bool add_currency=false) const;
 
-    inline Amount operator-() const { return Amount(-m_value); }
+    inline Amount operator-() const { return from_minor_units(-m_value); }
 
-    inline Amount operator+(const Amount &other) const { return Amount(m_value+other.m_value); }
-    inline Amount operator-(const Amount &other) const { return Amount(m_value-other.m_value); }
-    inline Amount operator/(const Amount &other) const { return Amount(m_value/other.m_value); }
-    inline Amount operator*(const Amount &other) const { return Amount(m_value*other.m_value); }
+    inline Amount operator+(const Amount &other) const { return from_minor_units(m_value+other.m_value); }
+    inline Amount operator-(const Amount &other) const { return from_minor_units(m_value-other.m_value); }
+    Amount operator/(const Amount &other) const;
+    Amount operator*(const Amount &other) const;
 
     inline const Amount &operator+=(const Amount &other) { m_value+=other.m_value; return *this; }
     inline const Amount &operator-=(const Amount &other) { m_value-=other.m_value; return *this; }
-    inline const Amount &operator/=(const Amount &other) { m_value/=other.m_value; return *this; }
-    inline const Amount &operator*=(const Amount &other) { m_value*=other.m_value; return *this; }
+    inline const Amount &operator/=(const Amount &other) { return *this=*this/other; }
+    inline const Amount &operator*=(const Amount &other) { return *this=*this*other; }
 
     inline bool operator<(const Amount &other) const { return m_value<other.m_value; }
     inline bool operator>(const Amount &other) const { return m_value>other.m_value; }
     inline bool operator<=(const Amount &other) const { return m_value<=other.m_value; }
     inline bool operator>=(const Amount &other) const { return m_value>=other.m_value; }
 
-    inline bool operator==(const Amount &other) const { return qFuzzyCompare(m_value, other.m_value); }
-    inline bool operator!=(const Amount &other) const { return !qFuzzyCompare(m_value, other.m_value); }
+    inline bool operator==(const Amount &other) const { return m_value==other.m_value; }
+    inline bool operator!=(const Amount &other) const { return m_value!=other.m_value; }
 
 private:
-    double m_value;
+    qint64 m_value;
 };
 
 QDebug operator<<(QDebug debug, const Amount &amount);
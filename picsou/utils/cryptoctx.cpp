@@ -141,12 +141,22 @@ bool CryptoCtx::wrap(const QByteArray &cdata, QString &wdata) const
 bool CryptoCtx::unwrap(const QString &pswd, const QString &wdata, QByteArray &cdata)
 {
     LOG_IN("pswd,wdata,cdata")
-    CHECK_SALT_CACHED();
     /* if DPK is already cached something is wrong */
     if(dpk_cached()) {
         LOG_CRITICAL("dpk is already cached meaning the object has been unwrapped already.")
         LOG_BOOL_RETURN(false)
     }
+    CryptoBuf dpk;
+    if(!unwrap(pswd, wdata, dpk, cdata)) {
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_BOOL_RETURN(cache_dpk(dpk))
+}
+
+bool CryptoCtx::unwrap(const QString &pswd, const QString &wdata, CryptoBuf &dpk, QByteArray &cdata) const
+{
+    LOG_IN("pswd,wdata,dpk,cdata")
+    CHECK_SALT_CACHED();
     /* retrieve MK */
     CryptoBuf mk;
     if(!derive(pswd, m_salt, mk)) {
@@ -154,7 +164,6 @@ bool CryptoCtx::unwrap(const QString &pswd, const QString &wdata, QByteArray &cd
         LOG_BOOL_RETURN(false)
     }
     /* decrypt DPK with MK */
-    CryptoBuf dpk;
     if(!decrypt(mk, m_wkey, dpk)) {
         LOG_CRITICAL("invalid user password.")
         LOG_BOOL_RETURN(false)
@@ -164,10 +173,33 @@ bool CryptoCtx::unwrap(const QString &pswd, const QString &wdata, QByteArray &cd
         LOG_CRITICAL("failed to decrypt data.")
         LOG_BOOL_RETURN(false)
     }
+    LOG_BOOL_RETURN(true)
+}
+
+bool CryptoCtx::cache_dpk(const CryptoBuf &dpk)
+{
+    LOG_IN("dpk")
+    /* if DPK is already cached something is wrong */
+    if(dpk_cached()) {
+        LOG_CRITICAL("dpk is already cached meaning the object has been unwrapped already.")
+        LOG_BOOL_RETURN(false)
+    }
     m_dpk=dpk;
     LOG_BOOL_RETURN(true)
 }
 
+bool CryptoCtx::unwrap(const QString &wdata, QByteArray &cdata) const
+{
+    LOG_IN("wdata,cdata")
+    CHECK_DPK_CACHED();
+    /* decrypt data with cached DPK */
+    if(!decrypt(m_dpk, wdata, cdata)) {
+        LOG_CRITICAL("failed to decrypt data.")
+        LOG_BOOL_RETURN(false)
+    }
+    LOG_BOOL_RETURN(true)
+}
+
 bool CryptoCtx::rewrap(const QString &prev_pswd, const QString &next_pswd)
 {
     LOG_IN("prev_pswd,next_pswd")
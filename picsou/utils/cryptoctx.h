@@ -77,6 +77,32 @@ public:
      * @return
      */
     bool unwrap(const QString &pswd, const QString &wdata, QByteArray &cdata);
+    /**
+     * @brief Unwraps given wdata into cdata without caching the DPK
+     * @details
+     *      Does not modify the context so it can be called from a worker
+     *      thread, cache_dpk() must then be called from the owning thread.
+     * @param pswd  User password
+     * @param wdata Wrapped data stored on disk
+     * @param dpk   Unwrapped DPK
+     * @param cdata Clear data to be used in memory
+     * @return
+     */
+    bool unwrap(const QString &pswd, const QString &wdata, CryptoBuf &dpk, QByteArray &cdata) const;
+    /**
+     * @brief Caches a DPK previously returned by unwrap()
+     * @param dpk Unwrapped DPK
+     * @return
+     */
+    bool cache_dpk(const CryptoBuf &dpk);
+    /**
+     * @brief Unwraps given wdata into cdata using cached DPK (m_dpk)
+     * @warning Requires dpk to be cached, meaning unwrap() must have been called before.
+     * @param wdata Wrapped data stored on disk
+     * @param cdata Clear data to be used in memory
+     * @return
+     */
+    bool unwrap(const QString &wdata, QByteArray &cdata) const;
     /**
      * @brief Rewraps DPK
      * @param prev_pswd Previous user password
@@ -88,39 +88,68 @@ bool Schedule::contains(const QDate &date) const
     return date>=m_from&&date<=m_until;
 }
 
-QList<QDate> Schedule::dates(int year, int month) const
+QDate Schedule::occurrence(int index) const
+{
+    switch (m_freq_unit) {
+        case DAY:
+            return m_from.addDays(qint64(index)*m_freq_value);
+        case WEEK:
+            return m_from.addDays(qint64(index)*m_freq_value*7);
+        case MONTH:
+            return m_from.addMonths(index*m_freq_value);
+        case YEAR:
+            return m_from.addYears(index*m_freq_value);
+    }
+    return QDate();
+}
+
+int Schedule::first_occurrence(const QDate &date) const
 {
-    QDate cdate=m_from,
-          until=(m_endless?QDate::currentDate():m_until);
+    if(date<=m_from||m_freq_value<=0) {
+        return 0;
+    }
+    /* jumps to the period containing date, at most one step short of it */
+    qint64 index=0;
+    switch (m_freq_unit) {
+        case DAY:
+            index=m_from.daysTo(date)/m_freq_value;
+            break;
+        case WEEK:
+            index=m_from.daysTo(date)/(m_freq_value*7);
+            break;
+        case MONTH:
+            index=((date.year()-m_from.year())*12+date.month()-m_from.month())/m_freq_value;
+            break;
+        case YEAR:
+            index=(date.year()-m_from.year())/m_freq_value;
+            break;
+    }
+    int first=int(qMax(qint64(0), index));
+    while(occurrence(first)<date) {
+        first++;
+    }
+    return first;
+}
 
+QList<QDate> Schedule::dates(int year, int month) const
+{
     QList<QDate> dates;
-    do {
-        /* check if date validates month & year constraints */
-        if(year==-1||cdate.year()==year) {
-            if(month==-1||cdate.month()==month) {
-                /* append a valid date */
-                dates.append(cdate);
-            }
-        }
-        /* compute next date */
-        switch (m_freq_unit) {
-            case DAY:
-                cdate=cdate.addDays(m_freq_value);
-                break;
-            case WEEK:
-                cdate=cdate.addDays(m_freq_value*7);
-                break;
-            case MONTH:
-                cdate=cdate.addMonths(m_freq_value);
-                break;
-            case YEAR:
-                cdate=cdate.addYears(m_freq_value);
-                break;
-        }
-    } while(cdate<=until);
+    for(const auto &date : occurrences(year, month)) {
+        dates.append(date);
+    }
     return dates;
 }
 
+Schedule::Occurrences Schedule::occurrences(int year, int month) const
+{
+    return Occurrences(*this, year, month);
+}
+
+Schedule::Occurrences Schedule::occurrences(const QDate &from, const QDate &to) const
+{
+    return Occurrences(*this, from, to);
+}
+
 void Schedule::update(const QDate &from,
                       const QDate &until,
                       bool endless,
@@ -133,3 +162,127 @@ void Schedule::update(const QDate &from,
     m_freq_value=freq_value;
     m_freq_unit=freq_unit;
 }
+
+Schedule::Occurrences::Occurrences(const Schedule &schedule, int year, int month) :
+    m_schedule(schedule),
+    m_year(year),
+    m_month(month),
+    m_lower(),
+    m_upper(),
+    m_until(schedule.m_endless?QDate::currentDate():schedule.m_until),
+    m_first_year(year!=-1?year:schedule.m_from.year()),
+    m_last_year(m_first_year)
+{
+    if(year==-1&&month!=-1) {
+        /* same month of every year the schedule spans */
+        m_last_year=qMax(schedule.m_from.year(), m_until.year());
+    }
+}
+
+Schedule::Occurrences::Occurrences(const Schedule &schedule, const QDate &lower, const QDate &upper) :
+    m_schedule(schedule),
+    m_year(-1),
+    m_month(-1),
+    m_lower(lower),
+    m_upper(upper),
+    m_until(schedule.m_endless?upper:schedule.m_until),
+    m_first_year(lower.year()),
+    m_last_year(m_first_year)
+{
+
+}
+
+Schedule::Occurrences::const_iterator Schedule::Occurrences::begin() const
+{
+    if(!m_schedule.m_from.isValid()||(m_lower.isValid()&&m_upper<m_lower)) {
+        return end();
+    }
+    return const_iterator(this);
+}
+
+QDate Schedule::Occurrences::lower(int year) const
+{
+    if(m_lower.isValid()) {
+        return m_lower;
+    }
+    if(m_year==-1&&m_month==-1) {
+        return m_schedule.m_from;
+    }
+    return QDate(year, (m_month==-1?1:m_month), 1);
+}
+
+QDate Schedule::Occurrences::upper(int year) const
+{
+    if(m_upper.isValid()) {
+        return m_upper;
+    }
+    if(m_year==-1&&m_month==-1) {
+        return qMax(m_schedule.m_from, m_until);
+    }
+    if(m_month==-1) {
+        return QDate(year, 12, 31);
+    }
+    return lower(year).addMonths(1).addDays(-1);
+}
+
+Schedule::Occurrences::const_iterator::const_iterator() :
+    m_range(nullptr),
+    m_year(0),
+    m_index(-1)
+{
+
+}
+
+Schedule::Occurrences::const_iterator::const_iterator(const Occurrences *range) :
+    m_range(range),
+    m_year(range->m_first_year),
+    m_index(range->m_schedule.first_occurrence(range->lower(m_year)))
+{
+    seek();
+}
+
+Schedule::Occurrences::const_iterator &Schedule::Occurrences::const_iterator::operator++()
+{
+    if(m_range->m_schedule.m_freq_value>0) {
+        m_index++;
+        seek();
+    } else if(next_window()) {
+        /* invalid frequency, a single occurrence */
+        seek();
+    }
+    return *this;
+}
+
+Schedule::Occurrences::const_iterator Schedule::Occurrences::const_iterator::operator++(int)
+{
+    const_iterator prev=*this;
+    ++(*this);
+    return prev;
+}
+
+bool Schedule::Occurrences::const_iterator::next_window()
+{
+    if(m_year>=m_range->m_last_year) {
+        *this=const_iterator();
+        return false;
+    }
+    m_year++;
+    m_index=m_range->m_schedule.first_occurrence(m_range->lower(m_year));
+    return true;
+}
+
+void Schedule::Occurrences::const_iterator::seek()
+{
+    /* the first occurrence is always generated, next ones until the end of the schedule */
+    for(;;) {
+        m_date=m_range->m_schedule.occurrence(m_index);
+        if(m_date>=m_range->lower(m_year)&&
+           m_date<=m_range->upper(m_year)&&
+           (m_index==0||m_date<=m_range->m_until)) {
+            return;
+        }
+        if(!next_window()) {
+            return;
+        }
+    }
+}
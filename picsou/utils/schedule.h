@@ -22,11 +22,15 @@
 #include <QStringList>
 #include <QCoreApplication>
 
+#include <iterator>
+
 class Schedule
 {
     Q_DECLARE_TR_FUNCTIONS(Schedule)
 
 public:
+    class Occurrences;
+
     enum FrequencyUnit {
         YEAR,
         MONTH,
@@ -68,6 +72,9 @@ public:
     bool valid() const;
     bool contains(const QDate &date) const;
     QList<QDate> dates(int year=-1, int month=-1) const;
+    Occurrences occurrences(int year=-1, int month=-1) const;
+    /* valid bounds are required, endless schedules are not cut at current date */
+    Occurrences occurrences(const QDate &from, const QDate &to) const;
 
     void update(const QDate &from,
                 const QDate &until,
@@ -75,6 +82,10 @@ public:
                 int freq_value,
                 FrequencyUnit freq_unit);
 
+private:
+    QDate occurrence(int index) const;
+    int first_occurrence(const QDate &date) const;
+
 private:
     QDate m_from;
     QDate m_until;
@@ -83,4 +94,62 @@ private:
     FrequencyUnit m_freq_unit;
 };
 
+/* occurrences of a schedule within a year and/or a month, computed one at a time */
+class Schedule::Occurrences
+{
+public:
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef QDate value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const QDate *pointer;
+        typedef const QDate &reference;
+
+        const_iterator();
+
+        inline const QDate &operator*() const { return m_date; }
+        inline const QDate *operator->() const { return &m_date; }
+        const_iterator &operator++();
+        const_iterator operator++(int);
+        inline bool operator==(const const_iterator &other) const { return m_index==other.m_index&&m_year==other.m_year; }
+        inline bool operator!=(const const_iterator &other) const { return !(*this==other); }
+
+    private:
+        friend class Schedule::Occurrences;
+
+        explicit const_iterator(const Occurrences *range);
+        bool next_window();
+        void seek();
+
+        const Occurrences *m_range;
+        int m_year;
+        int m_index;
+        QDate m_date;
+    };
+
+    const_iterator begin() const;
+    inline const_iterator end() const { return const_iterator(); }
+
+private:
+    friend class Schedule;
+
+    Occurrences(const Schedule &schedule, int year, int month);
+    Occurrences(const Schedule &schedule, const QDate &lower, const QDate &upper);
+    QDate lower(int year) const;
+    QDate upper(int year) const;
+
+    Schedule m_schedule;
+    int m_year;
+    int m_month;
+    /* explicit window, if any */
+    QDate m_lower;
+    QDate m_upper;
+    /* endless schedules stop at the date the range was created, or at the end of an explicit window */
+    QDate m_until;
+    int m_first_year;
+    int m_last_year;
+};
+
 #endif // SCHEDULE_H
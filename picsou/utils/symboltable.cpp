@@ -0,0 +1,88 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "symboltable.h"
+#include "utils/macro.h"
+
+const int SymbolTable::INVALID_SYMBOL;
+
+SymbolTable::SymbolTable() :
+    m_strs(nullptr)
+{
+    reset();
+}
+
+SymbolTable::~SymbolTable()
+{
+    qDeleteAll(m_retired);
+    delete m_strs.load();
+}
+
+int SymbolTable::intern(const QString &str)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, int>::const_iterator it=m_symbols.find(str);
+    if(it!=m_symbols.end()) {
+        return *it;
+    }
+    /* symbols may be read by search threads while being interned */
+    const Strings *prev=m_strs.loadAcquire();
+    Strings *next=new Strings(*prev);
+    int symbol=next->size();
+    next->append(str);
+    m_symbols.insert(str, symbol);
+    m_strs.storeRelease(next);
+    m_retired.append(prev);
+    return symbol;
+}
+
+int SymbolTable::find(const QString &str) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_symbols.value(str, INVALID_SYMBOL);
+}
+
+QString SymbolTable::str(int symbol) const
+{
+    const Strings *strs=m_strs.loadAcquire();
+    if(symbol<0||symbol>=strs->size()) {
+        return QString();
+    }
+    return strs->at(symbol);
+}
+
+int SymbolTable::count() const
+{
+    return m_strs.loadAcquire()->size();
+}
+
+void SymbolTable::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    qDeleteAll(m_retired);
+    m_retired.clear();
+    delete m_strs.load();
+    m_strs.store(nullptr);
+    reset();
+}
+
+void SymbolTable::reset()
+{
+    m_symbols.clear();
+    m_symbols.insert(QString(""), 0);
+    m_strs.storeRelease(new Strings(1, QString("")));
+}
@@ -0,0 +1,60 @@
+/*
+ *  Picsou | Keep track of your expenses !
+ *  Copyright (C) 2018  koromodako
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+#include <QString>
+#include <QAtomicPointer>
+
+/* interns strings having few distinct values as small integer symbols,
+   symbol 0 is always the empty string */
+class SymbolTable
+{
+public:
+    static const int INVALID_SYMBOL=-1;
+
+    SymbolTable();
+    ~SymbolTable();
+
+    int intern(const QString &str);
+    int find(const QString &str) const;
+    QString str(int symbol) const;
+    int count() const;
+    /* drops every symbol, no reader may remain */
+    void clear();
+
+private:
+    Q_DISABLE_COPY(SymbolTable)
+
+    typedef QVector<QString> Strings;
+
+    void reset();
+
+    mutable QMutex m_mutex;
+    QHash<QString, int> m_symbols;
+    /* strings are published as immutable snapshots so that readers never lock,
+       previous snapshots are kept until clear() */
+    QAtomicPointer<const Strings> m_strs;
+    QList<const Strings*> m_retired;
+};
+
+#endif // SYMBOLTABLE_H